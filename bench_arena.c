@@ -0,0 +1,147 @@
+// arena 分配基准测试
+// 模拟处理请求的协程：每个请求分配若干小对象，请求结束后全部释放；
+// 比较 glibc malloc/free 与 co_alloc + co_arena_reset
+#define _GNU_SOURCE
+#include "coroutine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define DEFAULT_COROUTINES 1000
+#define DEFAULT_REQUESTS 1000
+#define ALLOCS_PER_REQUEST 32
+#define BENCH_STACK_SIZE (16 * 1024)
+#define BENCH_ARENA_SIZE (32 * 1024)
+#define OVERSIZED_EVERY 64              // 每64次分配一次超出 arena 的大块
+#define OVERSIZED_SIZE (48 * 1024)
+
+typedef struct bench_ctx {
+    int use_arena;
+    int requests;
+    uint32_t seed;
+    uint64_t checksum;
+} bench_ctx_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t next_rand(uint32_t *s) {
+    *s = *s * 1103515245u + 12345u;
+    return *s >> 8;
+}
+
+static size_t next_size(uint32_t *s, int i) {
+    if (i % OVERSIZED_EVERY == OVERSIZED_EVERY - 1) {
+        return OVERSIZED_SIZE;
+    }
+    return 16 + next_rand(s) % 496;
+}
+
+static void request_body(void *arg) {
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    void *ptrs[ALLOCS_PER_REQUEST];
+    int seq = 0;
+    
+    for (int r = 0; r < ctx->requests; r++) {
+        if (ctx->use_arena) {
+            co_arena_mark_t mark = co_arena_mark();
+            for (int i = 0; i < ALLOCS_PER_REQUEST; i++) {
+                size_t size = next_size(&ctx->seed, seq++);
+                char *p = (char *)co_alloc(size);
+                if (p == NULL) {
+                    fprintf(stderr, "co_alloc 失败\n");
+                    exit(1);
+                }
+                p[0] = (char)i;
+                p[size - 1] = (char)r;
+                ctx->checksum += (uintptr_t)p[0];
+            }
+            co_arena_reset(mark);
+        } else {
+            for (int i = 0; i < ALLOCS_PER_REQUEST; i++) {
+                size_t size = next_size(&ctx->seed, seq++);
+                char *p = (char *)malloc(size);
+                if (p == NULL) {
+                    fprintf(stderr, "malloc 失败\n");
+                    exit(1);
+                }
+                p[0] = (char)i;
+                p[size - 1] = (char)r;
+                ctx->checksum += (uintptr_t)p[0];
+                ptrs[i] = p;
+            }
+            for (int i = 0; i < ALLOCS_PER_REQUEST; i++) {
+                free(ptrs[i]);
+            }
+        }
+        
+        // 请求之间让出，使各协程的分配交错进行
+        coroutine_t *self = coroutine_current();
+        coroutine_schedule(coroutine_handle(self));
+        coroutine_yield(self);
+    }
+}
+
+static double run(int use_arena, int ncos, int requests) {
+    bench_ctx_t *ctxs = (bench_ctx_t *)calloc(ncos, sizeof(*ctxs));
+    
+    for (int i = 0; i < ncos; i++) {
+        ctxs[i].use_arena = use_arena;
+        ctxs[i].requests = requests;
+        ctxs[i].seed = (uint32_t)i + 1;
+        coroutine_t *co = coroutine_create_arena(request_body, &ctxs[i], BENCH_STACK_SIZE,
+                                                 use_arena ? BENCH_ARENA_SIZE : 0);
+        if (co == NULL) {
+            fprintf(stderr, "coroutine_create 失败\n");
+            exit(1);
+        }
+        coroutine_detach(co);
+        coroutine_schedule(coroutine_handle(co));
+    }
+    
+    double t0 = now_sec();
+    while (coroutine_ready_count() > 0) {
+        coroutine_run_ready();
+    }
+    double elapsed = now_sec() - t0;
+    
+    uint64_t sum = 0;
+    for (int i = 0; i < ncos; i++) {
+        sum += ctxs[i].checksum;
+    }
+    free(ctxs);
+    
+    double allocs = (double)ncos * requests * ALLOCS_PER_REQUEST;
+    printf("%-8s %8.2f ns/分配（含释放）  总计 %.3f 秒  (校验 %llu)\n",
+           use_arena ? "arena" : "malloc", elapsed * 1e9 / allocs, elapsed,
+           (unsigned long long)sum);
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    int ncos = DEFAULT_COROUTINES;
+    int requests = DEFAULT_REQUESTS;
+    
+    if (argc > 1) {
+        ncos = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        requests = atoi(argv[2]);
+    }
+    if (ncos <= 0 || requests <= 0) {
+        fprintf(stderr, "使用方法: %s [协程数量] [每个协程的请求数]\n", argv[0]);
+        return 1;
+    }
+    
+    printf("=== arena 基准测试: %d 个协程 × %d 个请求 × %d 次分配（每 %d 次一个 %d 字节大块）===\n",
+           ncos, requests, ALLOCS_PER_REQUEST, OVERSIZED_EVERY, OVERSIZED_SIZE);
+    double t_malloc = run(0, ncos, requests);
+    double t_arena = run(1, ncos, requests);
+    printf("加速比: %.2fx\n", t_malloc / t_arena);
+    return 0;
+}
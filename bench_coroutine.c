@@ -0,0 +1,251 @@
+// 协程控制块布局基准测试
+// 比较 slab 控制块 + 句柄（当前实现）与旧布局（每个协程单独 malloc、
+// 8 个寄存器保存在控制块中）在大量协程下的切换和扫描开销
+#define _GNU_SOURCE
+#include "coroutine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define DEFAULT_COUNT 1000000
+#define DEFAULT_ROUNDS 3
+#define BENCH_STACK_SIZE 1024
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ---------------------------------------------------------------------------
+// 旧布局：与改造前的 coroutine_t 一致，控制块和栈各自 malloc，
+// 上下文保存 8 个寄存器（含 rip）
+// ---------------------------------------------------------------------------
+
+typedef struct legacy_context {
+    void *regs[8];  // rbx, rbp, r12-r15, rsp, rip
+} legacy_context_t;
+
+typedef struct legacy_co {
+    void *stack;
+    size_t stack_size;
+    coroutine_state_t state;
+    void (*func)(void *);
+    void *arg;
+    struct legacy_co *caller;
+    char *stack_top;
+    legacy_context_t ctx;
+} legacy_co_t;
+
+void legacy_context_switch(legacy_context_t *from, legacy_context_t *to);
+
+// 改造前 context_switch.S 的原样拷贝
+__asm__(
+    ".text\n"
+    ".global legacy_context_switch\n"
+    "legacy_context_switch:\n"
+    "    movq %rbx, 0(%rdi)\n"
+    "    movq %rbp, 8(%rdi)\n"
+    "    movq %r12, 16(%rdi)\n"
+    "    movq %r13, 24(%rdi)\n"
+    "    movq %r14, 32(%rdi)\n"
+    "    movq %r15, 40(%rdi)\n"
+    "    movq %rsp, 48(%rdi)\n"
+    "    movq (%rsp), %rax\n"
+    "    movq %rax, 56(%rdi)\n"
+    "    movq 0(%rsi), %rbx\n"
+    "    movq 8(%rsi), %rbp\n"
+    "    movq 16(%rsi), %r12\n"
+    "    movq 24(%rsi), %r13\n"
+    "    movq 32(%rsi), %r14\n"
+    "    movq 40(%rsi), %r15\n"
+    "    movq 48(%rsi), %rsp\n"
+    "    movq 56(%rsi), %rax\n"
+    "    movq %rax, (%rsp)\n"
+    "    ret\n"
+);
+
+static legacy_co_t *legacy_current = NULL;
+static legacy_context_t legacy_main_context;
+
+static void legacy_entry(void) {
+    legacy_co_t *co = legacy_current;
+    co->func(co->arg);
+    co->state = COROUTINE_FINISHED;
+    legacy_current = NULL;
+    legacy_context_switch(&co->ctx, &legacy_main_context);
+}
+
+static legacy_co_t *legacy_create(void (*func)(void *), void *arg, size_t stack_size) {
+    legacy_co_t *co = (legacy_co_t *)malloc(sizeof(legacy_co_t));
+    if (co == NULL) {
+        return NULL;
+    }
+    co->stack = malloc(stack_size);
+    if (co->stack == NULL) {
+        free(co);
+        return NULL;
+    }
+    co->stack_size = stack_size;
+    co->func = func;
+    co->arg = arg;
+    co->state = COROUTINE_READY;
+    co->caller = NULL;
+    co->stack_top = (char *)(((uintptr_t)co->stack + stack_size) & ~(uintptr_t)0xF);
+    memset(&co->ctx, 0, sizeof(co->ctx));
+    char *initial_rsp = co->stack_top - 256;
+    ((void **)initial_rsp)[0] = (void *)legacy_entry;
+    co->ctx.regs[6] = initial_rsp;
+    co->ctx.regs[7] = (void *)legacy_entry;
+    return co;
+}
+
+static void legacy_destroy(legacy_co_t *co) {
+    free(co->stack);
+    free(co);
+}
+
+static void legacy_resume(legacy_co_t *co) {
+    co->caller = legacy_current;
+    co->state = COROUTINE_RUNNING;
+    legacy_current = co;
+    legacy_context_switch(&legacy_main_context, &co->ctx);
+    legacy_current = NULL;
+}
+
+static void legacy_yield(legacy_co_t *co) {
+    co->state = COROUTINE_SUSPENDED;
+    legacy_context_switch(&co->ctx, &legacy_main_context);
+    co->state = COROUTINE_RUNNING;
+}
+
+static void legacy_body(void *arg) {
+    (void)arg;
+    for (;;) {
+        legacy_yield(legacy_current);
+    }
+}
+
+static void slab_body(void *arg) {
+    (void)arg;
+    for (;;) {
+        coroutine_yield(coroutine_current());
+    }
+}
+
+static void bench_legacy(size_t n, int rounds) {
+    legacy_co_t **cos = (legacy_co_t **)malloc(n * sizeof(*cos));
+    
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; i++) {
+        cos[i] = legacy_create(legacy_body, NULL, BENCH_STACK_SIZE);
+        if (cos[i] == NULL) {
+            fprintf(stderr, "legacy_create 失败 (i=%zu)\n", i);
+            exit(1);
+        }
+    }
+    double t_create = now_sec() - t0;
+    
+    // 首次运行，让所有协程停在 yield 处
+    for (size_t i = 0; i < n; i++) {
+        legacy_resume(cos[i]);
+    }
+    
+    t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            legacy_resume(cos[i]);
+        }
+    }
+    double t_switch = now_sec() - t0;
+    
+    t0 = now_sec();
+    size_t suspended = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            suspended += cos[i]->state == COROUTINE_SUSPENDED;
+        }
+    }
+    double t_scan = now_sec() - t0;
+    
+    printf("%-8s create %7.1f ns/co  resume+yield %7.1f ns  scan %6.2f ns/co  (%zu)\n",
+           "legacy", t_create * 1e9 / n, t_switch * 1e9 / ((double)n * rounds),
+           t_scan * 1e9 / ((double)n * rounds), suspended);
+    
+    for (size_t i = 0; i < n; i++) {
+        legacy_destroy(cos[i]);
+    }
+    free(cos);
+}
+
+static void bench_slab(size_t n, int rounds) {
+    coroutine_handle_t *hs = (coroutine_handle_t *)malloc(n * sizeof(*hs));
+    
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; i++) {
+        coroutine_t *co = coroutine_create(slab_body, NULL, BENCH_STACK_SIZE);
+        if (co == NULL) {
+            fprintf(stderr, "coroutine_create 失败 (i=%zu)\n", i);
+            exit(1);
+        }
+        hs[i] = coroutine_handle(co);
+    }
+    double t_create = now_sec() - t0;
+    
+    for (size_t i = 0; i < n; i++) {
+        coroutine_resume_handle(hs[i]);
+    }
+    
+    // 通过就绪队列调度：每次恢复都校验句柄，并预取后续协程
+    t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            coroutine_schedule(hs[i]);
+        }
+        coroutine_run_ready();
+    }
+    double t_switch = now_sec() - t0;
+    
+    t0 = now_sec();
+    size_t suspended = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            coroutine_t *co = coroutine_lookup(hs[i]);
+            suspended += co != NULL && co->state == COROUTINE_SUSPENDED;
+        }
+    }
+    double t_scan = now_sec() - t0;
+    
+    printf("%-8s create %7.1f ns/co  resume+yield %7.1f ns  scan %6.2f ns/co  (%zu)\n",
+           "slab", t_create * 1e9 / n, t_switch * 1e9 / ((double)n * rounds),
+           t_scan * 1e9 / ((double)n * rounds), suspended);
+    
+    for (size_t i = 0; i < n; i++) {
+        coroutine_destroy(coroutine_lookup(hs[i]));
+    }
+    free(hs);
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = DEFAULT_COUNT;
+    int rounds = DEFAULT_ROUNDS;
+    
+    if (argc > 1) {
+        n = strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        rounds = atoi(argv[2]);
+    }
+    if (n == 0 || n > COROUTINE_SLAB_MAX || rounds <= 0) {
+        fprintf(stderr, "使用方法: %s [协程数量] [轮数]\n", argv[0]);
+        return 1;
+    }
+    
+    printf("=== 协程控制块基准测试: %zu 个协程, %d 轮, 栈 %d 字节 ===\n",
+           n, rounds, BENCH_STACK_SIZE);
+    bench_legacy(n, rounds);
+    bench_slab(n, rounds);
+    return 0;
+}
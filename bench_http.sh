@@ -0,0 +1,77 @@
+#!/bin/bash
+
+# HTTP Server 基准测试脚本
+# 依次用 1 / 100 / 10000 个长连接压测，报告请求/秒和延迟分位数
+# 使用方法: ./bench_http.sh [每轮秒数] [服务器线程数]
+
+set -e
+
+PORT=18080
+DURATION=${1:-5}
+THREADS=${2:-$(nproc)}
+SERVER_PID=0
+
+# 清理函数
+cleanup() {
+    if [ $SERVER_PID -ne 0 ]; then
+        kill -INT $SERVER_PID 2>/dev/null || true
+        wait $SERVER_PID 2>/dev/null || true
+    fi
+}
+
+# 注册清理函数
+trap cleanup EXIT
+
+echo "=== 编译项目 ==="
+make http_server load_gen
+
+# 1 万个连接时客户端和服务器各需要 1 万多个描述符
+ulimit -n $(ulimit -Hn) 2>/dev/null || true
+echo "描述符上限: $(ulimit -n)"
+
+echo ""
+echo "=== 启动 HTTP Server（$THREADS 个线程）==="
+./http_server -t $THREADS -i 30000 $PORT > /tmp/bench_http_server.log 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+if ! kill -0 $SERVER_PID 2>/dev/null; then
+    echo "错误: 服务器启动失败"
+    cat /tmp/bench_http_server.log
+    exit 1
+fi
+
+# 请求头超过接收缓冲区：应完整收到 431，而不是被 RST 打断
+echo ""
+echo "=== 请求头过大检查（9000 字节）==="
+BIG_HEADER=$(head -c 9000 /dev/zero | tr '\0' 'a')
+exec 3<>/dev/tcp/127.0.0.1/$PORT
+printf 'GET / HTTP/1.1\r\nHost: x\r\nX-Big: %s\r\n\r\n' "$BIG_HEADER" >&3
+STATUS=$(head -n 1 <&3 | tr -d '\r')
+exec 3<&-
+echo "响应: $STATUS"
+if [ "${STATUS#HTTP/1.1 431}" = "$STATUS" ]; then
+    echo "错误: 没有收到 431 响应"
+    exit 1
+fi
+
+for CONNS in 1 100 10000; do
+    if [ $CONNS -ge $(( $(ulimit -n) - 100 )) ]; then
+        echo ""
+        echo "跳过 $CONNS 个连接：描述符上限不足"
+        continue
+    fi
+    echo ""
+    echo "=== $CONNS 个连接 ==="
+    ./load_gen http -p $PORT -c $CONNS -d $DURATION
+done
+
+echo ""
+echo "=== 100 个连接，流水线深度 16 ==="
+./load_gen http -p $PORT -c 100 -b 16 -d $DURATION
+
+cleanup
+SERVER_PID=0
+echo ""
+echo "=== 服务器统计 ==="
+sed -n '/收到停止信号/,$p' /tmp/bench_http_server.log
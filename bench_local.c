@@ -0,0 +1,184 @@
+// 协程局部存储基准测试
+// 大量协程频繁切换，每次被调度后读取若干个局部变量（请求上下文、日志标签等）；
+// 比较 co_local_get、每次切换后用 pthread_setspecific 重新绑定再 pthread_getspecific，
+// 以及按键哈希查找的协程私有表
+#define _GNU_SOURCE
+#include "coroutine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#define DEFAULT_COROUTINES 1000
+#define DEFAULT_SWITCHES 2000
+#define LOOKUPS_PER_SWITCH 16
+#define BENCH_KEYS 4                    // 每个协程使用的键，最后一个落在溢出槽位
+#define BENCH_STACK_SIZE (16 * 1024)
+#define HASH_SLOTS 16                   // 协程私有哈希表容量（2的幂）
+
+enum { MODE_CO_LOCAL, MODE_PTHREAD, MODE_HASH };
+static const char *mode_names[] = { "co_local", "pthread", "hash" };
+
+// 协程私有的开放寻址哈希表（键为键编号）
+typedef struct hash_entry {
+    uint32_t key;                       // 0 表示空槽
+    void *value;
+} hash_entry_t;
+
+typedef struct bench_ctx {
+    int mode;
+    int switches;
+    uint64_t checksum;
+    uint64_t values[BENCH_KEYS];
+    hash_entry_t table[HASH_SLOTS];
+} bench_ctx_t;
+
+static co_local_key_t co_keys[BENCH_KEYS];
+static pthread_key_t pthread_keys[BENCH_KEYS];
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t hash_key(uint32_t key) {
+    key ^= key >> 16;
+    key *= 0x7feb352du;
+    key ^= key >> 15;
+    return key;
+}
+
+static void hash_set(hash_entry_t *table, uint32_t key, void *value) {
+    uint32_t i = hash_key(key) & (HASH_SLOTS - 1);
+    while (table[i].key != 0 && table[i].key != key) {
+        i = (i + 1) & (HASH_SLOTS - 1);
+    }
+    table[i].key = key;
+    table[i].value = value;
+}
+
+static void *hash_get(const hash_entry_t *table, uint32_t key) {
+    uint32_t i = hash_key(key) & (HASH_SLOTS - 1);
+    while (table[i].key != 0) {
+        if (table[i].key == key) {
+            return table[i].value;
+        }
+        i = (i + 1) & (HASH_SLOTS - 1);
+    }
+    return NULL;
+}
+
+static void local_body(void *arg) {
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+
+    for (int k = 0; k < BENCH_KEYS; k++) {
+        if (ctx->mode == MODE_CO_LOCAL) {
+            co_local_set(co_keys[k], &ctx->values[k]);
+        } else if (ctx->mode == MODE_HASH) {
+            hash_set(ctx->table, (uint32_t)k + 1, &ctx->values[k]);
+        }
+    }
+
+    coroutine_t *self = coroutine_current();
+    for (int s = 0; s < ctx->switches; s++) {
+        // 线程级的键在协程之间共享，只能在每次切换回来后重新绑定
+        if (ctx->mode == MODE_PTHREAD) {
+            for (int k = 0; k < BENCH_KEYS; k++) {
+                pthread_setspecific(pthread_keys[k], &ctx->values[k]);
+            }
+        }
+
+        for (int i = 0; i < LOOKUPS_PER_SWITCH; i++) {
+            int k = i % BENCH_KEYS;
+            uint64_t *v;
+            if (ctx->mode == MODE_CO_LOCAL) {
+                v = (uint64_t *)co_local_get(co_keys[k]);
+            } else if (ctx->mode == MODE_PTHREAD) {
+                v = (uint64_t *)pthread_getspecific(pthread_keys[k]);
+            } else {
+                v = (uint64_t *)hash_get(ctx->table, (uint32_t)k + 1);
+            }
+            ctx->checksum += *v;
+        }
+
+        coroutine_schedule(coroutine_handle(self));
+        coroutine_yield(self);
+    }
+}
+
+static double run(int mode, int ncos, int switches) {
+    bench_ctx_t *ctxs = (bench_ctx_t *)calloc(ncos, sizeof(*ctxs));
+
+    for (int i = 0; i < ncos; i++) {
+        ctxs[i].mode = mode;
+        ctxs[i].switches = switches;
+        for (int k = 0; k < BENCH_KEYS; k++) {
+            ctxs[i].values[k] = (uint64_t)i * BENCH_KEYS + k;
+        }
+        coroutine_t *co = coroutine_create(local_body, &ctxs[i], BENCH_STACK_SIZE);
+        if (co == NULL) {
+            fprintf(stderr, "coroutine_create 失败\n");
+            exit(1);
+        }
+        coroutine_detach(co);
+        coroutine_schedule(coroutine_handle(co));
+    }
+
+    double t0 = now_sec();
+    while (coroutine_ready_count() > 0) {
+        coroutine_run_ready();
+    }
+    double elapsed = now_sec() - t0;
+
+    uint64_t sum = 0;
+    for (int i = 0; i < ncos; i++) {
+        sum += ctxs[i].checksum;
+    }
+    free(ctxs);
+
+    double nswitch = (double)ncos * switches;
+    printf("%-9s %8.2f ns/切换（含 %d 次查找）  总计 %.3f 秒  (校验 %llu)\n",
+           mode_names[mode], elapsed * 1e9 / nswitch, LOOKUPS_PER_SWITCH, elapsed,
+           (unsigned long long)sum);
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    int ncos = DEFAULT_COROUTINES;
+    int switches = DEFAULT_SWITCHES;
+
+    if (argc > 1) {
+        ncos = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        switches = atoi(argv[2]);
+    }
+    if (ncos <= 0 || switches <= 0) {
+        fprintf(stderr, "使用方法: %s [协程数量] [每个协程的切换次数]\n", argv[0]);
+        return 1;
+    }
+
+    // 先占满内联槽位，让最后一个键落在溢出数组中
+    for (int k = 0; k < COROUTINE_LOCAL_INLINE - (BENCH_KEYS - 1); k++) {
+        co_local_key_t unused;
+        co_local_key_create(&unused, NULL);
+    }
+    for (int k = 0; k < BENCH_KEYS; k++) {
+        if (co_local_key_create(&co_keys[k], NULL) < 0 ||
+            pthread_key_create(&pthread_keys[k], NULL) != 0) {
+            fprintf(stderr, "注册键失败\n");
+            return 1;
+        }
+    }
+
+    printf("=== 协程局部存储基准测试: %d 个协程 × %d 次切换 × %d 次查找（%d 个键，1 个在溢出槽位）===\n",
+           ncos, switches, LOOKUPS_PER_SWITCH, BENCH_KEYS);
+    double t_local = run(MODE_CO_LOCAL, ncos, switches);
+    double t_pthread = run(MODE_PTHREAD, ncos, switches);
+    double t_hash = run(MODE_HASH, ncos, switches);
+    printf("加速比: 对比 pthread %.2fx，对比哈希表 %.2fx\n", t_pthread / t_local, t_hash / t_local);
+    return 0;
+}
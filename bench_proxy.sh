@@ -0,0 +1,65 @@
+#!/bin/bash
+
+# TCP Proxy 基准测试脚本
+# 以 echo_server 为上游，分别测量直连、splice 代理和 recv/send 复制代理的吞吐量，
+# 并打印代理进程每转发 1 GB 消耗的 CPU 时间
+# 使用方法: ./bench_proxy.sh [每轮秒数] [连接数] [块大小]
+
+set -e
+
+UPSTREAM_PORT=18888
+PROXY_PORT=19000
+DURATION=${1:-5}
+CONNS=${2:-4}
+CHUNK=${3:-65536}
+UPSTREAM_PID=0
+PROXY_PID=0
+
+# 清理函数
+cleanup() {
+    for PID in $PROXY_PID $UPSTREAM_PID; do
+        if [ $PID -ne 0 ]; then
+            kill -INT $PID 2>/dev/null || true
+            wait $PID 2>/dev/null || true
+        fi
+    done
+}
+
+# 注册清理函数
+trap cleanup EXIT
+
+echo "=== 编译项目 ==="
+make echo_server proxy_server load_gen
+
+echo ""
+echo "=== 启动上游 Echo Server ==="
+./echo_server -q $UPSTREAM_PORT > /tmp/bench_proxy_upstream.log 2>&1 &
+UPSTREAM_PID=$!
+sleep 1
+
+echo ""
+echo "=== 直连上游（无代理）==="
+./load_gen stream -p $UPSTREAM_PORT -c $CONNS -s $CHUNK -d $DURATION
+
+for MODE in splice copy; do
+    FLAG=""
+    if [ $MODE = copy ]; then
+        FLAG="-c"
+    fi
+    
+    echo ""
+    echo "=== 代理（$MODE）==="
+    ./proxy_server $FLAG -u 127.0.0.1:$UPSTREAM_PORT $PROXY_PORT > /tmp/bench_proxy_$MODE.log 2>&1 &
+    PROXY_PID=$!
+    sleep 1
+    
+    ./load_gen stream -p $PROXY_PORT -c $CONNS -s $CHUNK -d $DURATION
+    
+    kill -INT $PROXY_PID
+    wait $PROXY_PID 2>/dev/null || true
+    PROXY_PID=0
+    sed -n '/代理统计/,/CPU 时间/p' /tmp/bench_proxy_$MODE.log
+    
+    # 等上一轮的连接完全关闭后再启动下一轮
+    sleep 1
+done
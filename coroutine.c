@@ -1,36 +1,267 @@
+#define _GNU_SOURCE
 #include "coroutine.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <assert.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// 内部标志
+#define COROUTINE_FLAG_LIVE     0x1u  // 槽位正在使用
+#define COROUTINE_FLAG_DETACHED 0x2u  // 完成后自动销毁
+#define COROUTINE_FLAG_QUEUED   0x4u  // 已在就绪队列中
+#define COROUTINE_FLAG_LOCALS   0x8u  // 设置过局部存储，结束时需要运行析构函数
+
+#define SLAB_INDEX_NONE UINT32_MAX
+
+_Static_assert(sizeof(context_t) == 8, "context_t 只保存 rsp");
+_Static_assert(offsetof(coroutine_t, func) == COROUTINE_CACHE_LINE,
+               "热字段必须放在第一个缓存行");
+_Static_assert(sizeof(((coroutine_t *)0)->locals) == COROUTINE_CACHE_LINE,
+               "内联局部存储槽位正好占一个缓存行");
+
+// 运行时状态都是线程私有的：每个线程拥有独立的协程、slab、内存块池和就绪队列，
+// 协程和句柄只能在创建它的线程中使用
 
 // 当前运行的协程
-static coroutine_t *current_coroutine = NULL;
+static _Thread_local coroutine_t *current_coroutine = NULL;
 
 // 协程入口函数包装
 static void coroutine_entry(void);
 
 // 主协程上下文（用于保存主线程的上下文）
-static context_t main_context;
+static _Thread_local context_t main_context;
+
+// 控制块 slab：一次性预留 COROUTINE_SLAB_MAX 个控制块的虚拟地址，
+// 下标直接映射到地址，已发出的指针永远不会因扩容而失效
+static _Thread_local coroutine_t *slab = NULL;
+static _Thread_local uint32_t slab_used = 0;                 // 曾经使用过的最大下标 + 1
+static _Thread_local uint32_t slab_free_head = SLAB_INDEX_NONE;
+
+// 空闲内存块池（LIFO），块头部复用为链表节点
+// 带 arena 的块在 arena 和栈之间有一个 PROT_NONE 保护页，guard 为其偏移（0 表示没有）；
+// 保护页在池中保持不变，只有大小和偏移都相同的块才能复用
+typedef struct pool_block {
+    struct pool_block *next;
+    size_t size;
+    size_t guard;
+} pool_block_t;
+
+static _Thread_local pool_block_t *pool_head = NULL;
+static _Thread_local size_t pool_count = 0;
+
+// arena 的堆回退块头部（保证数据区16字节对齐）
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    size_t pad;
+} arena_chunk_t;
+
+// 协程局部存储的键是进程级的（所有线程共用同一套下标），只增不减
+// 注册分两步：先预留下标并写入析构函数，再按下标顺序发布 local_key_count（release），
+// 读到计数（acquire）的线程一定能看到对应的析构函数
+static atomic_uint local_key_reserved = 0;
+static atomic_uint local_key_count = 0;
+static void (*local_destructors[COROUTINE_LOCAL_MAX])(void *);
+
+// 就绪队列（句柄环形缓冲区，容量为2的幂）
+static _Thread_local coroutine_handle_t *ready_queue = NULL;
+static _Thread_local size_t ready_cap = 0;
+static _Thread_local size_t ready_head = 0;
+static _Thread_local size_t ready_count = 0;
+
+static int slab_init(void) {
+    size_t bytes = (size_t)COROUTINE_SLAB_MAX * sizeof(coroutine_t);
+    void *mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) {
+        return -1;
+    }
+    slab = (coroutine_t *)mem;
+    return 0;
+}
+
+static coroutine_t *slab_alloc(void) {
+    if (slab == NULL && slab_init() < 0) {
+        return NULL;
+    }
+    
+    coroutine_t *co;
+    if (slab_free_head != SLAB_INDEX_NONE) {
+        co = &slab[slab_free_head];
+        slab_free_head = co->next_free;
+    } else {
+        if (slab_used == COROUTINE_SLAB_MAX) {
+            return NULL;
+        }
+        co = &slab[slab_used];
+        co->index = slab_used;
+        co->generation = 1;  // 代数从1开始，保证有效句柄不为0
+        slab_used++;
+    }
+    
+    co->flags = COROUTINE_FLAG_LIVE;
+    co->next_free = SLAB_INDEX_NONE;
+    return co;
+}
+
+static void slab_free(coroutine_t *co) {
+    co->flags = 0;
+    co->generation++;
+    if (co->generation == 0) {
+        co->generation = 1;
+    }
+    co->next_free = slab_free_head;
+    slab_free_head = co->index;
+}
+
+static size_t page_size(void) {
+    static size_t size = 0;
+    if (size == 0) {
+        long n = sysconf(_SC_PAGESIZE);
+        size = n > 0 ? (size_t)n : 4096;
+    }
+    return size;
+}
+
+// 归还给 malloc 之前恢复保护页的读写权限
+static void block_free(void *mem, size_t guard) {
+    if (guard != 0) {
+        mprotect((char *)mem + guard, page_size(), PROT_READ | PROT_WRITE);
+    }
+    free(mem);
+}
+
+// 从池中取出大小和保护页偏移完全相同的内存块，没有则重新分配
+// 带保护页的块按页对齐分配；mprotect 失败（如映射数量达到上限）时块仍可用，只是没有保护
+static void *pool_get(size_t size, size_t guard) {
+    pool_block_t **pp = &pool_head;
+    // 只检查前几个块，服务器中的协程通常使用相同的大小
+    for (int i = 0; *pp != NULL && i < 4; i++, pp = &(*pp)->next) {
+        if ((*pp)->size == size && (*pp)->guard == guard) {
+            pool_block_t *b = *pp;
+            *pp = b->next;
+            pool_count--;
+            return b;
+        }
+    }
+    if (guard == 0) {
+        return malloc(size);
+    }
+    void *mem;
+    if (posix_memalign(&mem, page_size(), size) != 0) {
+        return NULL;
+    }
+    mprotect((char *)mem + guard, page_size(), PROT_NONE);
+    return mem;
+}
+
+static void pool_put(void *mem, size_t size, size_t guard) {
+    if (pool_count >= COROUTINE_POOL_MAX || size < sizeof(pool_block_t)) {
+        block_free(mem, guard);
+        return;
+    }
+    pool_block_t *b = (pool_block_t *)mem;
+    b->next = pool_head;
+    b->size = size;
+    b->guard = guard;
+    pool_head = b;
+    pool_count++;
+}
+
+// 带 arena 的块中保护页的偏移（紧跟在按页对齐的 arena 之后）
+static size_t block_guard(const coroutine_t *co) {
+    return (size_t)(co->arena_end - co->arena_base);
+}
+
+// 释放 arena 中的全部分配（协程结束或被回收时）
+static void arena_release(coroutine_t *co) {
+    arena_chunk_t *c = (arena_chunk_t *)co->arena_heap;
+    while (c != NULL) {
+        arena_chunk_t *next = c->next;
+        free(c);
+        c = next;
+    }
+    co->arena_heap = NULL;
+    co->arena_cur = co->arena_base;
+}
+
+// 对非 NULL 的局部存储值运行析构函数，然后清空全部槽位并释放溢出数组
+// 析构函数可能重新设置值（例如在其中调用了 co_local_set），最多重复若干轮
+static void locals_release(coroutine_t *co) {
+    if (!(co->flags & COROUTINE_FLAG_LOCALS)) {
+        return;
+    }
+    
+    uint32_t nkeys = atomic_load_explicit(&local_key_count, memory_order_acquire);
+    for (int round = 0; round < COROUTINE_LOCAL_DESTRUCTOR_ROUNDS; round++) {
+        int again = 0;
+        for (uint32_t k = 0; k < nkeys; k++) {
+            void **slot;
+            if (k < COROUTINE_LOCAL_INLINE) {
+                slot = &co->locals[k];
+            } else if (k - COROUTINE_LOCAL_INLINE < co->locals_cap) {
+                slot = &co->locals_overflow[k - COROUTINE_LOCAL_INLINE];
+            } else {
+                break;
+            }
+            void *value = *slot;
+            if (value != NULL && local_destructors[k] != NULL) {
+                *slot = NULL;
+                local_destructors[k](value);
+                again = 1;
+            }
+        }
+        if (!again) {
+            break;
+        }
+    }
+    
+    memset(co->locals, 0, sizeof(co->locals));
+    free(co->locals_overflow);
+    co->locals_overflow = NULL;
+    co->locals_cap = 0;
+    co->flags &= ~COROUTINE_FLAG_LOCALS;
+}
 
 coroutine_t *coroutine_create(void (*func)(void *), void *arg, size_t stack_size) {
+    return coroutine_create_arena(func, arg, stack_size, 0);
+}
+
+coroutine_t *coroutine_create_arena(void (*func)(void *), void *arg,
+                                    size_t stack_size, size_t arena_size) {
     if (func == NULL || stack_size == 0) {
         return NULL;
     }
     
-    coroutine_t *co = (coroutine_t *)malloc(sizeof(coroutine_t));
+    coroutine_t *co = slab_alloc();
     if (co == NULL) {
         return NULL;
     }
     
-    // 分配栈空间（需要16字节对齐）
-    co->stack = malloc(stack_size);
+    // 栈和 arena 在同一个内存块中分配：arena 在低地址，栈在高地址。
+    // arena 向上取整到整页，后面跟一个 PROT_NONE 保护页，栈溢出时立即触发 SIGSEGV，
+    // 而不是悄悄覆盖 arena 中的数据
+    size_t guard = 0;
+    if (arena_size > 0) {
+        arena_size = (arena_size + page_size() - 1) & ~(page_size() - 1);
+        guard = arena_size;
+    }
+    co->block_size = arena_size + (guard != 0 ? page_size() : 0) + stack_size;
+    co->stack = pool_get(co->block_size, guard);
     if (co->stack == NULL) {
-        free(co);
+        slab_free(co);
         return NULL;
     }
     
+    co->arena_base = (char *)co->stack;
+    co->arena_cur = co->arena_base;
+    co->arena_end = co->arena_base + arena_size;
+    co->arena_heap = NULL;
+    
     co->stack_size = stack_size;
     co->func = func;
     co->arg = arg;
@@ -38,39 +269,44 @@ coroutine_t *coroutine_create(void (*func)(void *), void *arg, size_t stack_size
     co->caller = NULL;
     
     // 栈顶对齐到16字节边界（x86-64 ABI要求）
-    uintptr_t stack_ptr = (uintptr_t)co->stack + stack_size;
+    uintptr_t stack_ptr = (uintptr_t)co->stack + co->block_size;
     stack_ptr = (stack_ptr & ~0xF);  // 16字节对齐
     co->stack_top = (char *)stack_ptr;
     
-    // 初始化上下文
-    memset(&co->ctx, 0, sizeof(context_t));
-    
-    // 设置初始栈指针（为协程入口函数预留空间）
+    // 设置初始栈（为协程入口函数预留空间）
     // 栈向下增长，需要预留空间用于函数调用
     char *initial_rsp = co->stack_top - 256;  // 预留256字节
     
-    // 在栈上设置返回地址（模拟函数调用）
-    // 这样当context_switch恢复时，ret指令会跳转到coroutine_entry
+    // 在栈上伪造一次 context_switch 保存的现场：
+    // 6个被调用者保存寄存器（rbx、rbp、r12-r15，初始为0）加返回地址。
+    // context_switch 弹出寄存器后 ret 跳转到 coroutine_entry，
+    // 此时 rsp ≡ 8 (mod 16)，与正常函数调用后的对齐一致
     void **stack_frame = (void **)initial_rsp;
-    stack_frame[0] = (void *)coroutine_entry;  // 返回地址
+    memset(stack_frame, 0, 6 * sizeof(void *));
+    stack_frame[6] = (void *)coroutine_entry;  // 返回地址
     
     // 设置上下文
     co->ctx.rsp = initial_rsp;
-    co->ctx.rip = (void *)coroutine_entry;
     
     return co;
 }
 
 void coroutine_destroy(coroutine_t *co) {
-    if (co == NULL) {
+    if (co == NULL || !(co->flags & COROUTINE_FLAG_LIVE)) {
         return;
     }
     
+    // 未执行完就被回收的协程：析构函数先于 arena 释放运行，值可以指向 arena
+    locals_release(co);
+    arena_release(co);
+    
+    // 内存块进入池中，供后续创建的协程复用
     if (co->stack != NULL) {
-        free(co->stack);
+        pool_put(co->stack, co->block_size, block_guard(co));
+        co->stack = NULL;
     }
     
-    free(co);
+    slab_free(co);
 }
 
 // 协程入口函数
@@ -81,6 +317,10 @@ static void coroutine_entry(void) {
         co->state = COROUTINE_RUNNING;
         co->func(co->arg);
         co->state = COROUTINE_FINISHED;
+        
+        // 协程结束：运行局部存储的析构函数，然后整体释放 arena
+        locals_release(co);
+        arena_release(co);
     }
     
     // 协程执行完毕，返回到调用者
@@ -155,6 +395,11 @@ void coroutine_resume(coroutine_t *co) {
             prev->state = COROUTINE_RUNNING;
         }
     }
+    
+    // 已分离的协程执行完毕，此时已回到恢复者的栈上，可以安全回收
+    if (co->state == COROUTINE_FINISHED && (co->flags & COROUTINE_FLAG_DETACHED)) {
+        coroutine_destroy(co);
+    }
 }
 
 void coroutine_yield(coroutine_t *co) {
@@ -184,3 +429,268 @@ void coroutine_yield(coroutine_t *co) {
 coroutine_t *coroutine_current(void) {
     return current_coroutine;
 }
+
+coroutine_handle_t coroutine_handle(const coroutine_t *co) {
+    if (co == NULL || !(co->flags & COROUTINE_FLAG_LIVE)) {
+        return COROUTINE_HANDLE_INVALID;
+    }
+    return ((coroutine_handle_t)co->generation << 32) | co->index;
+}
+
+coroutine_t *coroutine_lookup(coroutine_handle_t h) {
+    uint32_t index = (uint32_t)h;
+    uint32_t generation = (uint32_t)(h >> 32);
+    
+    if (index >= slab_used) {
+        return NULL;
+    }
+    
+    coroutine_t *co = &slab[index];
+    if (co->generation != generation || !(co->flags & COROUTINE_FLAG_LIVE)) {
+        return NULL;
+    }
+    return co;
+}
+
+int coroutine_resume_handle(coroutine_handle_t h) {
+    coroutine_t *co = coroutine_lookup(h);
+    if (co == NULL || co->state == COROUTINE_FINISHED) {
+        return -1;
+    }
+    coroutine_resume(co);
+    return 0;
+}
+
+void coroutine_detach(coroutine_t *co) {
+    if (co == NULL || !(co->flags & COROUTINE_FLAG_LIVE)) {
+        return;
+    }
+    co->flags |= COROUTINE_FLAG_DETACHED;
+}
+
+static int ready_grow(void) {
+    size_t new_cap = ready_cap ? ready_cap * 2 : 256;
+    coroutine_handle_t *q = (coroutine_handle_t *)malloc(new_cap * sizeof(*q));
+    if (q == NULL) {
+        return -1;
+    }
+    
+    // 把环形缓冲区展开成从0开始的连续数组
+    for (size_t i = 0; i < ready_count; i++) {
+        q[i] = ready_queue[(ready_head + i) & (ready_cap - 1)];
+    }
+    free(ready_queue);
+    ready_queue = q;
+    ready_cap = new_cap;
+    ready_head = 0;
+    return 0;
+}
+
+int coroutine_schedule(coroutine_handle_t h) {
+    coroutine_t *co = coroutine_lookup(h);
+    if (co == NULL) {
+        return -1;
+    }
+    if (co->flags & COROUTINE_FLAG_QUEUED) {
+        return 0;
+    }
+    if (ready_count == ready_cap && ready_grow() < 0) {
+        return -1;
+    }
+    
+    ready_queue[(ready_head + ready_count) & (ready_cap - 1)] = h;
+    ready_count++;
+    co->flags |= COROUTINE_FLAG_QUEUED;
+    return 0;
+}
+
+// 预取句柄对应的控制块（不校验代数，预取无副作用）
+static inline coroutine_t *ready_peek(size_t offset) {
+    if (offset >= ready_count) {
+        return NULL;
+    }
+    uint32_t index = (uint32_t)ready_queue[(ready_head + offset) & (ready_cap - 1)];
+    return index < slab_used ? &slab[index] : NULL;
+}
+
+size_t coroutine_run_ready(void) {
+    size_t n = ready_count;
+    size_t resumed = 0;
+    
+    for (size_t i = 0; i < n; i++) {
+        // 提前两个位置预取控制块，提前一个位置预取其栈上保存的现场
+        coroutine_t *ahead = ready_peek(2);
+        if (ahead != NULL) {
+            __builtin_prefetch(ahead, 1);
+        }
+        coroutine_t *next = ready_peek(1);
+        if (next != NULL && next->ctx.rsp != NULL) {
+            __builtin_prefetch(next->ctx.rsp);
+        }
+        
+        coroutine_handle_t h = ready_queue[ready_head];
+        ready_head = (ready_head + 1) & (ready_cap - 1);
+        ready_count--;
+        
+        coroutine_t *co = coroutine_lookup(h);
+        if (co == NULL) {
+            continue;
+        }
+        co->flags &= ~COROUTINE_FLAG_QUEUED;
+        if (co->state == COROUTINE_FINISHED) {
+            continue;
+        }
+        coroutine_resume(co);
+        resumed++;
+    }
+    
+    return resumed;
+}
+
+size_t coroutine_ready_count(void) {
+    return ready_count;
+}
+
+void coroutine_thread_exit(void) {
+    if (current_coroutine != NULL) {
+        return;
+    }
+    
+    if (slab != NULL) {
+        for (uint32_t i = 0; i < slab_used; i++) {
+            coroutine_destroy(&slab[i]);
+        }
+        munmap(slab, (size_t)COROUTINE_SLAB_MAX * sizeof(coroutine_t));
+        slab = NULL;
+        slab_used = 0;
+        slab_free_head = SLAB_INDEX_NONE;
+    }
+    
+    while (pool_head != NULL) {
+        pool_block_t *b = pool_head;
+        pool_head = b->next;
+        block_free(b, b->guard);
+    }
+    pool_count = 0;
+    
+    free(ready_queue);
+    ready_queue = NULL;
+    ready_cap = ready_head = ready_count = 0;
+}
+
+void *co_alloc(size_t size) {
+    coroutine_t *co = current_coroutine;
+    if (co == NULL || size > SIZE_MAX - COROUTINE_ARENA_ALIGN - sizeof(arena_chunk_t)) {
+        return NULL;
+    }
+    
+    size = (size + COROUTINE_ARENA_ALIGN - 1) & ~(size_t)(COROUTINE_ARENA_ALIGN - 1);
+    if (size <= (size_t)(co->arena_end - co->arena_cur)) {
+        void *p = co->arena_cur;
+        co->arena_cur += size;
+        return p;
+    }
+    
+    // arena 放不下，回退到堆，挂到链表上等待统一释放
+    arena_chunk_t *c = (arena_chunk_t *)malloc(sizeof(arena_chunk_t) + size);
+    if (c == NULL) {
+        return NULL;
+    }
+    c->next = (arena_chunk_t *)co->arena_heap;
+    co->arena_heap = c;
+    return c + 1;
+}
+
+co_arena_mark_t co_arena_mark(void) {
+    co_arena_mark_t mark = { NULL, NULL };
+    coroutine_t *co = current_coroutine;
+    if (co != NULL) {
+        mark.cur = co->arena_cur;
+        mark.heap = co->arena_heap;
+    }
+    return mark;
+}
+
+void co_arena_reset(co_arena_mark_t mark) {
+    coroutine_t *co = current_coroutine;
+    if (co == NULL || mark.cur == NULL) {
+        return;
+    }
+    
+    // 释放复位点之后的堆回退块（链表头插，复位点之后的块都在前面）
+    arena_chunk_t *c = (arena_chunk_t *)co->arena_heap;
+    while (c != NULL && c != (arena_chunk_t *)mark.heap) {
+        arena_chunk_t *next = c->next;
+        free(c);
+        c = next;
+    }
+    co->arena_heap = c;
+    co->arena_cur = mark.cur;
+}
+
+int co_local_key_create(co_local_key_t *key, void (*destructor)(void *)) {
+    unsigned int k = atomic_load_explicit(&local_key_reserved, memory_order_relaxed);
+    do {
+        if (k >= COROUTINE_LOCAL_MAX) {
+            return -1;
+        }
+    } while (!atomic_compare_exchange_weak(&local_key_reserved, &k, k + 1));
+    
+    local_destructors[k] = destructor;
+    
+    // 等前面预留的键发布完再发布自己，计数始终覆盖连续的已初始化下标
+    unsigned int expected = k;
+    while (!atomic_compare_exchange_weak_explicit(&local_key_count, &expected, k + 1,
+                                                  memory_order_release, memory_order_relaxed)) {
+        expected = k;
+    }
+    *key = k;
+    return 0;
+}
+
+void *co_local_get(co_local_key_t key) {
+    coroutine_t *co = current_coroutine;
+    if (co == NULL) {
+        return NULL;
+    }
+    if (key < COROUTINE_LOCAL_INLINE) {
+        return co->locals[key];
+    }
+    key -= COROUTINE_LOCAL_INLINE;
+    return key < co->locals_cap ? co->locals_overflow[key] : NULL;
+}
+
+int co_local_set(co_local_key_t key, void *value) {
+    coroutine_t *co = current_coroutine;
+    if (co == NULL || key >= COROUTINE_LOCAL_MAX) {
+        return -1;
+    }
+    
+    if (key < COROUTINE_LOCAL_INLINE) {
+        co->flags |= COROUTINE_FLAG_LOCALS;
+        co->locals[key] = value;
+        return 0;
+    }
+    
+    // 溢出槽位：按需扩容（至少翻倍），新增部分清零
+    uint32_t slot = key - COROUTINE_LOCAL_INLINE;
+    if (slot >= co->locals_cap) {
+        if (value == NULL) {
+            return 0;
+        }
+        uint32_t cap = co->locals_cap ? co->locals_cap * 2 : COROUTINE_LOCAL_INLINE;
+        while (cap <= slot) {
+            cap *= 2;
+        }
+        void **p = (void **)realloc(co->locals_overflow, cap * sizeof(void *));
+        if (p == NULL) {
+            return -1;
+        }
+        memset(p + co->locals_cap, 0, (cap - co->locals_cap) * sizeof(void *));
+        co->locals_overflow = p;
+        co->locals_cap = cap;
+    }
+    co->flags |= COROUTINE_FLAG_LOCALS;
+    co->locals_overflow[slot] = value;
+    return 0;
+}
@@ -2,6 +2,28 @@
 #define COROUTINE_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+// 缓存行大小（x86-64）
+#define COROUTINE_CACHE_LINE 64
+
+// 控制块 slab 最多容纳的协程数（虚拟地址一次性预留，按需缺页）
+#define COROUTINE_SLAB_MAX (1u << 22)
+
+// 缓存的空闲内存块（栈 + arena）数量上限，超出后直接 free
+#define COROUTINE_POOL_MAX 1024
+
+// co_alloc 返回的内存对齐
+#define COROUTINE_ARENA_ALIGN 16
+
+// 协程局部存储：控制块内联的槽位数（正好一个缓存行），超出的键放在堆上的溢出数组
+#define COROUTINE_LOCAL_INLINE 8
+
+// 可注册的协程局部存储键总数
+#define COROUTINE_LOCAL_MAX 1024
+
+// 析构函数把值重新设为非 NULL 时最多重复的轮数（同 PTHREAD_DESTRUCTOR_ITERATIONS）
+#define COROUTINE_LOCAL_DESTRUCTOR_ROUNDS 4
 
 // 协程状态
 typedef enum {
@@ -11,32 +33,65 @@ typedef enum {
     COROUTINE_FINISHED   // 完成
 } coroutine_state_t;
 
-// 上下文结构体（用于保存寄存器）
-// 必须在 coroutine_t 之前定义，因为 coroutine_t 需要使用它
+// 上下文结构体
+// 被调用者保存寄存器（rbx、rbp、r12-r15）和返回地址直接压在协程自己的栈上，
+// 这里只需要记录栈指针，使控制块的热字段能放进一个缓存行
 typedef struct context {
-    void *rbx;    // 保存 rbx
-    void *rbp;    // 保存 rbp
-    void *r12;    // 保存 r12
-    void *r13;    // 保存 r13
-    void *r14;    // 保存 r14
-    void *r15;    // 保存 r15
     void *rsp;    // 保存栈指针
-    void *rip;    // 保存指令指针
 } context_t;
 
-// 协程结构体
+// 协程句柄：低 32 位为 slab 下标，高 32 位为代数（generation）
+// 协程销毁后代数递增，旧句柄随即失效，不会误用被复用的控制块
+typedef uint64_t coroutine_handle_t;
+
+#define COROUTINE_HANDLE_INVALID ((coroutine_handle_t)0)
+
+// 协程局部存储的键：注册时分配的稠密槽位下标
+typedef uint32_t co_local_key_t;
+
+// 协程结构体（控制块）
+// 控制块存放在连续的 slab 中，按缓存行对齐：
+// 第一个缓存行是每次切换都会访问的热字段，第二个缓存行是只在创建/销毁时访问的冷字段，
+// 最后一个缓存行是协程局部存储的内联槽位
 typedef struct coroutine {
-    void *stack;              // 栈指针
-    size_t stack_size;        // 栈大小
+    // 热字段
+    _Alignas(COROUTINE_CACHE_LINE)
+    context_t ctx;            // 保存的上下文
     coroutine_state_t state;  // 状态
+    uint32_t generation;      // 代数，与句柄中的代数比对
+    struct coroutine *caller; // 调用者协程
+    uint32_t index;           // 在 slab 中的下标
+    uint32_t flags;           // 内部标志（存活、已分离、已入就绪队列）
+    char *arena_cur;          // arena 当前分配位置
+    char *arena_end;          // arena 末尾
+
+    // 冷字段
+    _Alignas(COROUTINE_CACHE_LINE)
     void (*func)(void *);     // 协程函数
     void *arg;                // 协程函数参数
-    struct coroutine *caller; // 调用者协程
+    void *stack;              // 内存块起始地址（arena 在前，栈在后）
+    size_t stack_size;        // 栈大小
     char *stack_top;          // 栈顶（用于对齐）
-    context_t ctx;            // 保存的上下文
+    uint32_t next_free;       // 空闲链表中的下一个下标
+    size_t block_size;        // 内存块总大小（arena + 栈），用于池化复用
+    char *arena_base;         // arena 起始地址
+    void *arena_heap;         // arena 放不下时从堆上分配的块（链表）
+    void **locals_overflow;   // 下标 >= COROUTINE_LOCAL_INLINE 的局部存储槽位
+    uint32_t locals_cap;      // 溢出数组的容量
+
+    // 协程局部存储（内联槽位，单独一个缓存行）
+    _Alignas(COROUTINE_CACHE_LINE)
+    void *locals[COROUTINE_LOCAL_INLINE];
 } coroutine_t;
 
+// arena 复位点：记录分配位置和堆回退链表头
+typedef struct co_arena_mark {
+    char *cur;
+    void *heap;
+} co_arena_mark_t;
+
 // API函数声明
+// 运行时状态是线程私有的，协程指针和句柄不能跨线程使用
 
 /**
  * 创建协程
@@ -47,8 +102,22 @@ typedef struct coroutine {
  */
 coroutine_t *coroutine_create(void (*func)(void *), void *arg, size_t stack_size);
 
+/**
+ * 创建带 arena 的协程
+ * arena 与栈在同一个内存块中分配，协程结束或销毁时整体释放，内存块进入池中复用。
+ * arena 按页向上取整，和栈之间隔一个 PROT_NONE 保护页，栈溢出会触发 SIGSEGV
+ * @param func 协程函数
+ * @param arg 协程函数参数
+ * @param stack_size 栈大小（字节）
+ * @param arena_size arena 大小（字节），0 表示不使用 arena（co_alloc 全部回退到堆）
+ * @return 协程指针，失败返回NULL
+ */
+coroutine_t *coroutine_create_arena(void (*func)(void *), void *arg,
+                                    size_t stack_size, size_t arena_size);
+
 /**
  * 销毁协程
+ * 控制块归还 slab，代数递增，之前发出的句柄全部失效
  * @param co 协程指针
  */
 void coroutine_destroy(coroutine_t *co);
@@ -78,4 +147,105 @@ void coroutine_yield(coroutine_t *co);
  */
 coroutine_t *coroutine_current(void);
 
+/**
+ * 获取协程句柄
+ * @param co 协程指针
+ * @return 句柄，co 为 NULL 时返回 COROUTINE_HANDLE_INVALID
+ */
+coroutine_handle_t coroutine_handle(const coroutine_t *co);
+
+/**
+ * 通过句柄查找协程
+ * @param h 协程句柄
+ * @return 协程指针；句柄已失效（协程已销毁或槽位被复用）返回NULL
+ */
+coroutine_t *coroutine_lookup(coroutine_handle_t h);
+
+/**
+ * 通过句柄恢复协程
+ * @param h 协程句柄
+ * @return 0 成功，-1 句柄失效或协程已完成
+ */
+int coroutine_resume_handle(coroutine_handle_t h);
+
+/**
+ * 分离协程：协程执行完毕后，在返回到恢复者时自动销毁
+ * @param co 协程指针
+ */
+void coroutine_detach(coroutine_t *co);
+
+/**
+ * 将协程加入就绪队列（已在队列中的协程不会重复加入）
+ * @param h 协程句柄
+ * @return 0 成功，-1 句柄失效或内存不足
+ */
+int coroutine_schedule(coroutine_handle_t h);
+
+/**
+ * 依次恢复调用时就绪队列中的所有协程
+ * 运行期间新加入的协程留到下一次调用；扫描时预取后续协程的控制块和栈
+ * @return 实际恢复的协程数量
+ */
+size_t coroutine_run_ready(void);
+
+/**
+ * 获取就绪队列中等待运行的协程数量
+ * @return 协程数量
+ */
+size_t coroutine_ready_count(void);
+
+/**
+ * 释放当前线程的协程运行时：销毁所有仍存活的协程，归还控制块 slab 的虚拟地址
+ * （约 COROUTINE_SLAB_MAX × sizeof(coroutine_t)）、清空内存块池和就绪队列
+ * 工作线程退出前必须调用，否则这些线程私有的资源会泄漏；只能在协程之外调用
+ * 之后可以重新创建协程，但之前的句柄和指针全部失效
+ */
+void coroutine_thread_exit(void);
+
+/**
+ * 从当前协程的 arena 中分配内存（指针递增，16字节对齐）
+ * arena 放不下时回退到 malloc，由 arena 记录并在复位/结束时释放
+ * 内存在协程结束、销毁或复位到更早的复位点时失效，无需也不能单独 free
+ * @param size 字节数
+ * @return 内存指针，不在协程中或内存不足返回NULL
+ */
+void *co_alloc(size_t size);
+
+/**
+ * 获取当前协程 arena 的复位点（例如每个请求开始时）
+ * @return 复位点；不在协程中时返回全零
+ */
+co_arena_mark_t co_arena_mark(void);
+
+/**
+ * 把当前协程的 arena 复位到 mark，释放之后的全部分配（包括堆回退）
+ * @param mark co_arena_mark 的返回值
+ */
+void co_arena_reset(co_arena_mark_t mark);
+
+/**
+ * 注册协程局部存储键（通常在启动时注册一次，键不会被回收）
+ * 所有线程共享同一套键；每个协程的值各自独立，初始为 NULL
+ * @param key 输出：分配的槽位下标，前 COROUTINE_LOCAL_INLINE 个键存放在控制块内
+ * @param destructor 协程结束或被回收时对非 NULL 的值调用，可以为 NULL；
+ *                   调用时可能已不在该协程中，只能使用参数中的值
+ * @return 0 成功，-1 键已用完
+ */
+int co_local_key_create(co_local_key_t *key, void (*destructor)(void *));
+
+/**
+ * 读取当前协程中 key 的值（内联槽位只需一次下标访问，不做哈希）
+ * @param key 已注册的键
+ * @return 值；未设置或不在协程中返回 NULL
+ */
+void *co_local_get(co_local_key_t key);
+
+/**
+ * 设置当前协程中 key 的值
+ * @param key 已注册的键
+ * @param value 值
+ * @return 0 成功，-1 不在协程中、键无效或内存不足
+ */
+int co_local_set(co_local_key_t key, void *value);
+
 #endif // COROUTINE_H
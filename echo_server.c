@@ -1,30 +1,88 @@
+#define _GNU_SOURCE
 #include "echo_server.h"
+#include "reactor.h"
+#include "net.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <fcntl.h>
 #include <errno.h>
 #include <signal.h>
+#include <pthread.h>
+#include <netinet/udp.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+
+// 旧版 glibc 头文件可能缺少这些定义（内核 4.18 / 5.0 起支持）
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+// 每个消息的控制消息缓冲区大小（容纳一个 int 类型的 GRO 段大小）
+#define UDP_CMSG_SPACE CMSG_SPACE(sizeof(int))
+
+// 延迟接受：内核收到首个数据包后才让 accept 返回（秒）
+#define LAZY_DEFER_ACCEPT_SECS 1
+
+// 内联处理结果
+#define INLINE_DONE 0       // 连接已在内联路径上处理完毕并关闭
+#define INLINE_PROMOTE 1    // 连接需要挂起，转交给专门的协程
+
+// 内联路径最多处理的读取次数（含读到 EOF 的那次），之后转交给协程，
+// 避免持续发送的客户端占住接受连接协程
+#define INLINE_MAX_READS 4
+
+// 连接日志（-q 时关闭，避免基准测试被输出拖慢）
+#define CONN_LOG(...) do { if (!quiet) printf(__VA_ARGS__); } while (0)
 
 static echo_server_t *server = NULL;
 static volatile int running = 1;
+static int quiet = 0;
 
-// 设置文件描述符为非阻塞模式
-static int set_nonblocking(int fd) {
-    int flags = fcntl(fd, F_GETFL, 0);
-    if (flags < 0) {
-        return -1;
-    }
-    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
-}
+// 内联路径的接收缓冲区（每线程一个）：内联处理在接受连接协程的栈上运行，
+// 同一时刻只处理一个连接
+static _Thread_local char inline_buffer[BUFFER_SIZE];
+
+// 客户端协程的启动参数，只在协程首次运行（第一次挂起之前）有效
+typedef struct client_start {
+    int fd;
+    const char *pending;     // 内联路径上没发完的回显数据
+    size_t pending_len;
+} client_start_t;
 
 // 处理客户端连接的协程函数
 static void client_handler(void *arg) {
-    client_conn_t *conn = (client_conn_t *)arg;
-    int fd = conn->fd;
+    const client_start_t *start = (const client_start_t *)arg;
+    int fd = start->fd;
+    
+    // 连接结构从协程的 arena 中分配，协程结束时随 arena 整体释放
+    client_conn_t *conn = (client_conn_t *)co_alloc(sizeof(client_conn_t));
+    if (conn == NULL) {
+        perror("co_alloc client_conn error");
+        goto out;
+    }
+    
+    conn->fd = fd;
+    conn->recv_len = 0;
+    conn->co = coroutine_current();
     
-    printf("[协程] 开始处理客户端连接 fd=%d\n", fd);
+    CONN_LOG("[协程] 开始处理客户端连接 fd=%d\n", fd);
+    
+    // 先发完内联路径遗留的数据（start 在第一次挂起后失效，先复制）
+    if (start->pending_len > 0) {
+        size_t len = start->pending_len;
+        memcpy(conn->buffer, start->pending, len);
+        if (net_send_all(fd, conn->buffer, len) < 0) {
+            perror("send error");
+            goto out;
+        }
+    }
     
     while (running) {
         // 接收数据
@@ -32,28 +90,29 @@ static void client_handler(void *arg) {
         
         if (n > 0) {
             conn->buffer[n] = '\0';
-            printf("[协程] 从客户端 fd=%d 接收到 %zd 字节: %.*s\n", 
-                   fd, n, (int)n, conn->buffer);
+            CONN_LOG("[协程] 从客户端 fd=%d 接收到 %zd 字节: %.*s\n", 
+                     fd, n, (int)n, conn->buffer);
             
-            // 回显数据
-            ssize_t sent = send(fd, conn->buffer, n, 0);
-            if (sent < 0) {
+            // 回显数据，发送缓冲区满时等待可写
+            if (net_send_all(fd, conn->buffer, n) < 0) {
                 perror("send error");
                 break;
             }
-            printf("[协程] 向客户端 fd=%d 发送了 %zd 字节\n", fd, sent);
+            CONN_LOG("[协程] 向客户端 fd=%d 发送了 %zd 字节\n", fd, n);
             
-            // 让出执行权，允许其他协程运行
-            coroutine_yield(coroutine_current());
+            // 边缘触发模式下必须读到 EAGAIN 才能等待下一次事件，这里继续读
         } else if (n == 0) {
             // 客户端关闭连接
-            printf("[协程] 客户端 fd=%d 关闭连接\n", fd);
+            CONN_LOG("[协程] 客户端 fd=%d 关闭连接\n", fd);
             break;
         } else {
             // 错误处理
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // 没有数据可读，让出执行权
-                coroutine_yield(coroutine_current());
+                // 没有数据可读，挂起直到 fd 可读
+                if (reactor_wait(fd, EPOLLIN) < 0) {
+                    perror("reactor_wait error");
+                    break;
+                }
                 continue;
             } else {
                 perror("recv error");
@@ -62,12 +121,51 @@ static void client_handler(void *arg) {
         }
     }
     
+out:
     // 关闭连接
+    reactor_remove(fd);
     close(fd);
-    printf("[协程] 关闭客户端连接 fd=%d\n", fd);
+    server->live_clients--;
+    CONN_LOG("[协程] 关闭客户端连接 fd=%d\n", fd);
+}
+
+// 在接受连接协程上直接处理新连接，不创建协程
+// 最多处理 INLINE_MAX_READS 次不阻塞的读写；需要等待或次数用完时，把剩余工作交给协程
+static int client_try_inline(int fd, client_start_t *start) {
+    for (int reads = 0; reads < INLINE_MAX_READS; reads++) {
+        ssize_t n = recv(fd, inline_buffer, BUFFER_SIZE, 0);
+        
+        if (n > 0) {
+            ssize_t sent = 0;
+            while (sent < n) {
+                ssize_t w = send(fd, inline_buffer + sent, n - sent, MSG_NOSIGNAL);
+                if (w < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        // 发送缓冲区满，剩余数据交给协程
+                        start->pending = inline_buffer + sent;
+                        start->pending_len = n - sent;
+                        return INLINE_PROMOTE;
+                    }
+                    close(fd);
+                    return INLINE_DONE;
+                }
+                sent += w;
+            }
+            CONN_LOG("[内联] 回显客户端 fd=%d %zd 字节\n", fd, n);
+        } else if (n == 0) {
+            CONN_LOG("[内联] 客户端 fd=%d 关闭连接\n", fd);
+            close(fd);
+            return INLINE_DONE;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return INLINE_PROMOTE;
+        } else {
+            close(fd);
+            return INLINE_DONE;
+        }
+    }
     
-    // 释放客户端连接结构
-    free(conn);
+    // 客户端仍在持续发送：交给协程，接受连接协程回到 accept
+    return INLINE_PROMOTE;
 }
 
 // 接受连接的协程函数
@@ -84,8 +182,13 @@ static void accept_handler(void *arg) {
         
         if (client_fd < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // 没有新连接，让出执行权
-                coroutine_yield(coroutine_current());
+                // 没有新连接，挂起直到监听套接字可读
+                if (reactor_wait(srv->listen_fd, EPOLLIN) < 0) {
+                    perror("reactor_wait error");
+                    break;
+                }
+                continue;
+            } else if (errno == EINTR || errno == ECONNABORTED) {
                 continue;
             } else {
                 perror("accept error");
@@ -94,56 +197,277 @@ static void accept_handler(void *arg) {
         }
         
         // 设置非阻塞
-        if (set_nonblocking(client_fd) < 0) {
+        if (net_set_nonblocking(client_fd) < 0) {
             perror("set_nonblocking error");
             close(client_fd);
             continue;
         }
         
-        // 添加到 epoll
-        struct epoll_event ev;
-        ev.events = EPOLLIN | EPOLLET;  // 边缘触发模式
-        ev.data.fd = client_fd;
+        CONN_LOG("[协程] 接受新连接: fd=%d, ip=%s, port=%d\n",
+                 client_fd, inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+        srv->conns_accepted++;
         
-        if (epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
-            perror("epoll_ctl ADD error");
-            close(client_fd);
+        client_start_t start = { client_fd, NULL, 0 };
+        
+        // 延迟创建：先在当前协程上尝试处理，不需要挂起的连接不占用协程
+        if (srv->lazy && client_try_inline(client_fd, &start) == INLINE_DONE) {
+            srv->conns_inline++;
             continue;
         }
         
-        printf("[协程] 接受新连接: fd=%d, ip=%s, port=%d\n",
-               client_fd, inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
-        
-        // 为每个客户端连接创建协程
-        client_conn_t *conn = (client_conn_t *)malloc(sizeof(client_conn_t));
-        if (conn == NULL) {
-            perror("malloc client_conn error");
+        // 为客户端连接创建协程（栈和 arena 来自内存块池）
+        coroutine_t *co = coroutine_create_arena(client_handler, &start,
+                                                 CLIENT_STACK_SIZE, CLIENT_ARENA_SIZE);
+        if (co == NULL) {
+            perror("coroutine_create error");
             close(client_fd);
             continue;
         }
         
-        conn->fd = client_fd;
-        conn->recv_len = 0;
-        memset(conn->buffer, 0, BUFFER_SIZE);
+        // 客户端协程执行完毕后自动回收
+        coroutine_detach(co);
         
-        coroutine_t *co = coroutine_create(client_handler, conn, 64 * 1024);
-        if (co == NULL) {
-            perror("coroutine_create error");
-            free(conn);
+        // 注册到 reactor（边缘触发），协程在 reactor_wait 中等待事件
+        if (reactor_add(client_fd) < 0) {
+            coroutine_destroy(co);
             close(client_fd);
             continue;
         }
         
-        conn->co = co;
+        srv->coroutines_spawned++;
+        if (++srv->live_clients > srv->peak_clients) {
+            srv->peak_clients = srv->live_clients;
+        }
         
-        // 启动客户端处理协程
+        // 启动客户端处理协程（start 在它第一次挂起前保持有效）
         coroutine_resume(co);
         
-        // 让出执行权
-        coroutine_yield(coroutine_current());
+        // 继续 accept 直到 EAGAIN（监听套接字同样是边缘触发）
     }
 }
 
+// 解析 GRO 控制消息，返回合并数据报的段大小（未合并返回0）
+static int udp_gro_size(struct msghdr *msg) {
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(msg); cm != NULL; cm = CMSG_NXTHDR(msg, cm)) {
+        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+            int size;
+            memcpy(&size, CMSG_DATA(cm), sizeof(size));
+            return size;
+        }
+    }
+    return 0;
+}
+
+// 为下一次 recvmmsg 重置描述符
+static void udp_shard_prepare_recv(udp_shard_t *sh) {
+    for (int i = 0; i < sh->batch; i++) {
+        struct msghdr *mh = &sh->msgs[i].msg_hdr;
+        sh->iovs[i].iov_base = sh->buffers + (size_t)i * sh->slot_size;
+        sh->iovs[i].iov_len = sh->slot_size;
+        mh->msg_name = &sh->addrs[i];
+        mh->msg_namelen = sizeof(sh->addrs[i]);
+        mh->msg_iov = &sh->iovs[i];
+        mh->msg_iovlen = 1;
+        mh->msg_control = sh->gso ? sh->cmsgs + (size_t)i * UDP_CMSG_SPACE : NULL;
+        mh->msg_controllen = sh->gso ? UDP_CMSG_SPACE : 0;
+        mh->msg_flags = 0;
+        sh->msgs[i].msg_len = 0;
+    }
+}
+
+// 把收到的第 i 个消息改写成回显消息，返回其中包含的数据报段数
+static unsigned int udp_shard_prepare_reply(udp_shard_t *sh, int i) {
+    struct msghdr *mh = &sh->msgs[i].msg_hdr;
+    size_t len = sh->msgs[i].msg_len;
+    int gso_size = sh->gso ? udp_gro_size(mh) : 0;
+    
+    sh->iovs[i].iov_len = len;
+    mh->msg_flags = 0;
+    
+    if (gso_size > 0 && len > (size_t)gso_size) {
+        // 合并的数据报原样回送，由内核（或网卡）按原段大小重新分段
+        char *cbuf = sh->cmsgs + (size_t)i * UDP_CMSG_SPACE;
+        memset(cbuf, 0, UDP_CMSG_SPACE);
+        mh->msg_control = cbuf;
+        mh->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+        struct cmsghdr *cm = CMSG_FIRSTHDR(mh);
+        cm->cmsg_level = SOL_UDP;
+        cm->cmsg_type = UDP_SEGMENT;
+        cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t seg = (uint16_t)gso_size;
+        memcpy(CMSG_DATA(cm), &seg, sizeof(seg));
+        return (unsigned int)((len + gso_size - 1) / gso_size);
+    }
+    
+    mh->msg_control = NULL;
+    mh->msg_controllen = 0;
+    return 1;
+}
+
+// 驱动一个 UDP 分片的协程函数：批量接收，批量回显
+static void udp_shard_handler(void *arg) {
+    udp_shard_t *sh = (udp_shard_t *)arg;
+    unsigned int *segs = (unsigned int *)malloc(sh->batch * sizeof(*segs));
+    if (segs == NULL) {
+        perror("malloc udp segs error");
+        return;
+    }
+    
+    while (running) {
+        udp_shard_prepare_recv(sh);
+        int n = recvmmsg(sh->fd, sh->msgs, sh->batch, MSG_DONTWAIT, NULL);
+        sh->recv_calls++;
+        
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // 没有数据报，挂起直到套接字可读
+                if (reactor_wait(sh->fd, EPOLLIN) < 0) {
+                    perror("reactor_wait error");
+                    break;
+                }
+                continue;
+            } else if (errno == EINTR) {
+                continue;
+            }
+            perror("recvmmsg error");
+            break;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            segs[i] = udp_shard_prepare_reply(sh, i);
+            sh->datagrams_in += segs[i];
+        }
+        
+        // 批量回显，发送缓冲区满时等待可写
+        int sent = 0;
+        while (sent < n) {
+            int r = sendmmsg(sh->fd, sh->msgs + sent, n - sent, MSG_DONTWAIT);
+            sh->send_calls++;
+            if (r < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if (reactor_wait(sh->fd, EPOLLOUT) < 0) {
+                        perror("reactor_wait error");
+                        break;
+                    }
+                    continue;
+                } else if (errno == EINTR) {
+                    continue;
+                }
+                // UDP 不保证送达：跳过发送失败的数据报
+                sent++;
+                continue;
+            }
+            for (int i = sent; i < sent + r; i++) {
+                sh->datagrams_out += segs[i];
+            }
+            sent += r;
+        }
+    }
+    
+    free(segs);
+}
+
+// 初始化分片；失败时已分配的资源由 udp_shard_cleanup 释放
+static int udp_shard_init(udp_shard_t *sh, int port, const echo_udp_options_t *opts) {
+    memset(sh, 0, sizeof(*sh));
+    sh->batch = opts->batch;
+    sh->gso = opts->gso;
+    
+    sh->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sh->fd < 0) {
+        perror("socket error");
+        return -1;
+    }
+    
+    // 所有分片绑定同一端口，由内核按四元组哈希分发
+    int reuse = 1;
+    if (setsockopt(sh->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+        setsockopt(sh->fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+        perror("setsockopt error");
+        return -1;
+    }
+    
+    if (sh->gso) {
+        int on = 1;
+        if (setsockopt(sh->fd, SOL_UDP, UDP_GRO, &on, sizeof(on)) < 0) {
+            perror("setsockopt UDP_GRO error，禁用 GRO/GSO");
+            sh->gso = 0;
+        }
+    }
+    
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    
+    if (bind(sh->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind error");
+        return -1;
+    }
+    
+    if (net_set_nonblocking(sh->fd) < 0) {
+        perror("set_nonblocking error");
+        return -1;
+    }
+    
+    sh->slot_size = sh->gso ? UDP_GRO_BUFFER_SIZE : UDP_DATAGRAM_SIZE;
+    sh->buffers = (char *)malloc((size_t)sh->batch * sh->slot_size);
+    sh->msgs = (struct mmsghdr *)calloc(sh->batch, sizeof(*sh->msgs));
+    sh->iovs = (struct iovec *)calloc(sh->batch, sizeof(*sh->iovs));
+    sh->addrs = (struct sockaddr_in *)calloc(sh->batch, sizeof(*sh->addrs));
+    sh->cmsgs = (char *)calloc(sh->batch, UDP_CMSG_SPACE);
+    if (sh->buffers == NULL || sh->msgs == NULL || sh->iovs == NULL ||
+        sh->addrs == NULL || sh->cmsgs == NULL) {
+        perror("malloc udp shard error");
+        return -1;
+    }
+    return 0;
+}
+
+// 分片线程：私有的 reactor 和协程运行时，各分片的数据报并行处理
+static void *udp_shard_main(void *arg) {
+    udp_shard_t *sh = (udp_shard_t *)arg;
+    
+    if (reactor_init() < 0) {
+        return NULL;
+    }
+    if (reactor_add(sh->fd) < 0) {
+        reactor_destroy();
+        return NULL;
+    }
+    
+    coroutine_t *co = coroutine_create(udp_shard_handler, sh, 64 * 1024);
+    if (co == NULL) {
+        perror("coroutine_create udp_shard_handler error");
+        reactor_destroy();
+        coroutine_thread_exit();
+        return NULL;
+    }
+    coroutine_handle_t h = coroutine_handle(co);
+    coroutine_resume(co);
+    
+    reactor_run(&running);
+    
+    coroutine_destroy(coroutine_lookup(h));
+    reactor_remove(sh->fd);
+    reactor_destroy();
+    coroutine_thread_exit();
+    return NULL;
+}
+
+// 分片线程退出后释放套接字和缓冲区
+static void udp_shard_cleanup(udp_shard_t *sh) {
+    if (sh->fd >= 0) {
+        close(sh->fd);
+    }
+    free(sh->buffers);
+    free(sh->msgs);
+    free(sh->iovs);
+    free(sh->addrs);
+    free(sh->cmsgs);
+}
+
 // 信号处理函数
 static void signal_handler(int sig) {
     if (sig == SIGINT || sig == SIGTERM) {
@@ -152,8 +476,8 @@ static void signal_handler(int sig) {
     }
 }
 
-int echo_server_start(int port) {
-    // 创建服务器结构
+// 分配服务器结构、注册信号处理
+static int server_init(int port) {
     server = (echo_server_t *)malloc(sizeof(echo_server_t));
     if (server == NULL) {
         perror("malloc server error");
@@ -161,13 +485,43 @@ int echo_server_start(int port) {
     }
     
     memset(server, 0, sizeof(echo_server_t));
+    server->listen_fd = -1;
     server->port = port;
     
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+    return 0;
+}
+
+int echo_server_start(int port) {
+    return echo_server_start_tcp(port, NULL);
+}
+
+int echo_server_start_tcp(int port, const echo_tcp_options_t *opts) {
+    echo_tcp_options_t defaults = { 0, 0 };
+    if (opts == NULL) {
+        opts = &defaults;
+    }
+    
+    // 创建服务器结构
+    if (server_init(port) < 0) {
+        return -1;
+    }
+    server->lazy = opts->lazy;
+    quiet = opts->quiet;
+    
+    // TCP 模式在当前线程上运行 reactor
+    if (reactor_init() < 0) {
+        echo_server_stop();
+        return -1;
+    }
+    
     // 创建监听套接字
     server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (server->listen_fd < 0) {
         perror("socket error");
-        free(server);
+        echo_server_stop();
         return -1;
     }
     
@@ -175,8 +529,7 @@ int echo_server_start(int port) {
     int reuse = 1;
     if (setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
         perror("setsockopt error");
-        close(server->listen_fd);
-        free(server);
+        echo_server_stop();
         return -1;
     }
     
@@ -189,106 +542,169 @@ int echo_server_start(int port) {
     
     if (bind(server->listen_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
         perror("bind error");
-        close(server->listen_fd);
-        free(server);
+        echo_server_stop();
         return -1;
     }
     
     // 设置非阻塞
-    if (set_nonblocking(server->listen_fd) < 0) {
+    if (net_set_nonblocking(server->listen_fd) < 0) {
         perror("set_nonblocking error");
-        close(server->listen_fd);
-        free(server);
+        echo_server_stop();
         return -1;
     }
     
+    // 延迟创建模式下，等首个数据包到达后再 accept，提高内联路径的命中率
+    if (server->lazy) {
+        int defer = LAZY_DEFER_ACCEPT_SECS;
+        if (setsockopt(server->listen_fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &defer, sizeof(defer)) < 0) {
+            perror("setsockopt TCP_DEFER_ACCEPT error");
+        }
+    }
+    
     // 监听
     if (listen(server->listen_fd, DEFAULT_BACKLOG) < 0) {
         perror("listen error");
-        close(server->listen_fd);
-        free(server);
-        return -1;
-    }
-    
-    // 创建 epoll
-    server->epoll_fd = epoll_create1(0);
-    if (server->epoll_fd < 0) {
-        perror("epoll_create1 error");
-        close(server->listen_fd);
-        free(server);
+        echo_server_stop();
         return -1;
     }
     
-    // 将监听套接字添加到 epoll
-    struct epoll_event ev;
-    ev.events = EPOLLIN | EPOLLET;
-    ev.data.fd = server->listen_fd;
-    
-    if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &ev) < 0) {
-        perror("epoll_ctl ADD listen_fd error");
-        close(server->epoll_fd);
-        close(server->listen_fd);
-        free(server);
+    // 将监听套接字注册到 reactor
+    if (reactor_add(server->listen_fd) < 0) {
+        echo_server_stop();
         return -1;
     }
     
-    // 注册信号处理
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-    
     printf("=== Echo Server 启动 ===\n");
-    printf("监听端口: %d\n", port);
+    printf("监听端口: %d，延迟创建协程: %s\n", port, server->lazy ? "开启" : "关闭");
     printf("按 Ctrl+C 停止服务器\n\n");
     
     // 创建接受连接的协程
-    server->accept_co = coroutine_create(accept_handler, server, 64 * 1024);
-    if (server->accept_co == NULL) {
+    coroutine_t *accept_co = coroutine_create(accept_handler, server, 64 * 1024);
+    if (accept_co == NULL) {
         perror("coroutine_create accept_handler error");
-        close(server->epoll_fd);
-        close(server->listen_fd);
-        free(server);
+        echo_server_stop();
         return -1;
     }
+    server->accept_co = coroutine_handle(accept_co);
     
     // 启动接受连接协程
-    coroutine_resume(server->accept_co);
+    coroutine_resume(accept_co);
     
-    // 主事件循环
-    while (running) {
-        int nfds = epoll_wait(server->epoll_fd, server->events, MAX_EVENTS, 100);
-        
-        if (nfds < 0) {
-            if (errno == EINTR) {
-                continue;
-            }
-            perror("epoll_wait error");
-            break;
+    // 主事件循环：实际的 I/O 操作在协程中进行
+    reactor_run(&running);
+    
+    // 清理资源
+    echo_server_stop();
+    
+    return 0;
+}
+
+int echo_server_start_udp(int port, const echo_udp_options_t *opts) {
+    echo_udp_options_t defaults = { UDP_DEFAULT_SHARDS, UDP_DEFAULT_BATCH, 0 };
+    if (opts == NULL) {
+        opts = &defaults;
+    }
+    if (opts->shards <= 0 || opts->shards > UDP_MAX_SHARDS ||
+        opts->batch <= 0 || opts->batch > UDP_MAX_BATCH) {
+        fprintf(stderr, "无效的 UDP 选项: shards=%d batch=%d\n", opts->shards, opts->batch);
+        return -1;
+    }
+    
+    if (server_init(port) < 0) {
+        return -1;
+    }
+    
+    server->shards = (udp_shard_t *)calloc(opts->shards, sizeof(udp_shard_t));
+    if (server->shards == NULL) {
+        perror("malloc udp shards error");
+        echo_server_stop();
+        return -1;
+    }
+    
+    for (int i = 0; i < opts->shards; i++) {
+        server->shards[i].fd = -1;
+    }
+    
+    for (int i = 0; i < opts->shards; i++) {
+        udp_shard_t *sh = &server->shards[i];
+        server->nshards = i + 1;
+        if (udp_shard_init(sh, port, opts) < 0) {
+            echo_server_stop();
+            return -1;
         }
-        
-        // 处理事件（这里主要是触发协程继续执行）
-        // 实际的 I/O 操作在协程中进行
-        for (int i = 0; i < nfds; i++) {
-            if (server->events[i].data.fd == server->listen_fd) {
-                // 有新连接，恢复接受连接协程
-                if (server->accept_co && server->accept_co->state == COROUTINE_SUSPENDED) {
-                    coroutine_resume(server->accept_co);
-                }
-            } else {
-                // 客户端事件，这里可以触发对应的客户端协程
-                // 简化实现：所有客户端协程共享事件循环
-                // 在实际应用中，可以为每个客户端维护一个协程映射
-            }
+    }
+    
+    printf("=== UDP Echo Server 启动 ===\n");
+    printf("监听端口: %d，分片线程: %d，批量: %d，GRO/GSO: %s\n",
+           port, opts->shards, opts->batch, server->shards[0].gso ? "开启" : "关闭");
+    printf("按 Ctrl+C 停止服务器\n\n");
+    
+    // 每个分片一个线程；线程屏蔽信号，由主线程处理停止请求
+    int nstarted = 0;
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (int i = 0; i < server->nshards; i++) {
+        if (pthread_create(&server->shards[i].thread, NULL, udp_shard_main, &server->shards[i]) != 0) {
+            perror("pthread_create error");
+            running = 0;
+            break;
         }
-        
-        // 让所有就绪的协程运行
-        // 这里简化处理：定期恢复所有挂起的协程
-        // 实际应用中应该维护一个就绪协程队列
+        nstarted++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    
+    // 分片线程在 running 清零后的一个轮询周期内退出
+    for (int i = 0; i < nstarted; i++) {
+        pthread_join(server->shards[i].thread, NULL);
     }
     
-    // 清理资源
     echo_server_stop();
     
-    return 0;
+    return nstarted == opts->shards ? 0 : -1;
+}
+
+// 打印 UDP 统计：每个数据报平均的系统调用次数
+static void udp_print_stats(void) {
+    uint64_t in = 0, out = 0, recv_calls = 0, send_calls = 0;
+    for (int i = 0; i < server->nshards; i++) {
+        in += server->shards[i].datagrams_in;
+        out += server->shards[i].datagrams_out;
+        recv_calls += server->shards[i].recv_calls;
+        send_calls += server->shards[i].send_calls;
+    }
+    
+    printf("UDP 统计: 收到 %llu 个数据报，回显 %llu 个\n",
+           (unsigned long long)in, (unsigned long long)out);
+    printf("  recvmmsg %llu 次，sendmmsg %llu 次",
+           (unsigned long long)recv_calls, (unsigned long long)send_calls);
+    if (in > 0) {
+        printf("，每个数据报 %.3f 次系统调用", (double)(recv_calls + send_calls) / in);
+    }
+    printf("\n");
+}
+
+// 打印 TCP 统计：内联完成的连接比例和协程占用的内存
+static void tcp_print_stats(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    
+    printf("TCP 统计: 接受 %llu 个连接，内联完成 %llu 个，创建协程 %llu 个\n",
+           (unsigned long long)server->conns_accepted,
+           (unsigned long long)server->conns_inline,
+           (unsigned long long)server->coroutines_spawned);
+    printf("  同时存活的客户端协程峰值 %d 个（约 %d KiB 栈 + arena），进程峰值 RSS %ld KiB\n",
+           server->peak_clients,
+           server->peak_clients * (int)((CLIENT_STACK_SIZE + CLIENT_ARENA_SIZE) / 1024),
+           ru.ru_maxrss);
+    
+    double cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+                 ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    printf("  CPU 时间 %.2f 秒", cpu);
+    if (server->conns_accepted > 0) {
+        printf("，每个连接 %.1f 微秒", cpu * 1e6 / server->conns_accepted);
+    }
+    printf("\n");
 }
 
 void echo_server_stop(void) {
@@ -298,18 +714,26 @@ void echo_server_stop(void) {
     
     printf("\n正在关闭服务器...\n");
     
-    if (server->accept_co) {
-        coroutine_destroy(server->accept_co);
-    }
+    // 通过句柄查找，接受连接协程已被销毁时不会访问失效内存
+    coroutine_destroy(coroutine_lookup(server->accept_co));
     
-    if (server->epoll_fd >= 0) {
-        close(server->epoll_fd);
+    if (server->shards != NULL) {
+        udp_print_stats();
+        for (int i = 0; i < server->nshards; i++) {
+            udp_shard_cleanup(&server->shards[i]);
+        }
+        free(server->shards);
     }
     
     if (server->listen_fd >= 0) {
+        tcp_print_stats();
+        reactor_remove(server->listen_fd);
         close(server->listen_fd);
     }
     
+    reactor_destroy();
+    coroutine_thread_exit();
+    
     free(server);
     server = NULL;
     
@@ -2,16 +2,26 @@
 #define ECHO_SERVER_H
 
 #include "coroutine.h"
-#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <stdint.h>
+#include <pthread.h>
 
 // 服务器配置
-#define MAX_EVENTS 1024
 #define BUFFER_SIZE 4096
 #define DEFAULT_PORT 8888
 #define DEFAULT_BACKLOG 128
+#define CLIENT_STACK_SIZE (64 * 1024)  // 客户端协程栈大小
+#define CLIENT_ARENA_SIZE (8 * 1024)   // 客户端协程 arena 大小（容纳 client_conn_t）
+
+// UDP 模式配置
+#define UDP_DEFAULT_SHARDS 1         // 默认 SO_REUSEPORT 套接字（分片线程）数量
+#define UDP_DEFAULT_BATCH 32         // 默认每次 recvmmsg/sendmmsg 的数据报数
+#define UDP_MAX_BATCH 1024
+#define UDP_MAX_SHARDS 64
+#define UDP_DATAGRAM_SIZE 2048       // 不启用 GRO 时每个接收槽的大小
+#define UDP_GRO_BUFFER_SIZE 65536    // 启用 GRO 时每个接收槽的大小（可容纳合并后的数据报）
 
 // 客户端连接信息
 typedef struct client_conn {
@@ -21,13 +31,54 @@ typedef struct client_conn {
     coroutine_t *co;             // 处理该连接的协程
 } client_conn_t;
 
+// TCP 模式选项
+typedef struct echo_tcp_options {
+    int lazy;                    // 非0时先在接受连接协程上内联处理，需要挂起时才创建协程
+    int quiet;                   // 非0时不打印每个连接的日志
+} echo_tcp_options_t;
+
+// UDP 模式选项
+typedef struct echo_udp_options {
+    int shards;                  // SO_REUSEPORT 套接字数量，每个由一个线程上的协程驱动
+    int batch;                   // 每次 recvmmsg/sendmmsg 的最大数据报数
+    int gso;                     // 非0时启用 UDP_GRO 接收合并、UDP_SEGMENT 发送分段
+} echo_udp_options_t;
+
+// UDP 分片：一个 SO_REUSEPORT 套接字及其批量收发缓冲区
+typedef struct udp_shard {
+    int fd;                      // UDP 套接字
+    int batch;                   // 批量大小
+    int gso;                     // 是否启用 GRO/GSO
+    size_t slot_size;            // 每个接收槽的大小
+    char *buffers;               // batch 个接收槽
+    struct mmsghdr *msgs;        // recvmmsg/sendmmsg 描述符
+    struct iovec *iovs;
+    struct sockaddr_in *addrs;   // 对端地址
+    char *cmsgs;                 // 每个消息的控制消息缓冲区（GRO/GSO 段大小）
+    pthread_t thread;            // 分片线程（私有 reactor，协程在其中运行）
+    
+    // 统计
+    uint64_t datagrams_in;       // 收到的数据报（GRO 合并的按段计数）
+    uint64_t datagrams_out;      // 回显的数据报（按段计数）
+    uint64_t recv_calls;         // recvmmsg 调用次数
+    uint64_t send_calls;         // sendmmsg 调用次数
+} udp_shard_t;
+
 // 服务器结构
 typedef struct echo_server {
-    int listen_fd;               // 监听套接字
-    int epoll_fd;                // epoll 文件描述符
+    int listen_fd;               // 监听套接字（TCP 模式）
     int port;                    // 监听端口
-    struct epoll_event events[MAX_EVENTS];  // epoll 事件数组
-    coroutine_t *accept_co;      // 接受连接的协程
+    coroutine_handle_t accept_co; // 接受连接的协程（句柄，销毁后自动失效）
+    udp_shard_t *shards;         // UDP 分片（UDP 模式）
+    int nshards;                 // UDP 分片数量
+    int lazy;                    // 延迟创建客户端协程
+    
+    // TCP 统计
+    uint64_t conns_accepted;     // 接受的连接数
+    uint64_t conns_inline;       // 在内联路径上处理完毕的连接数
+    uint64_t coroutines_spawned; // 创建的客户端协程数
+    int live_clients;            // 当前存活的客户端协程
+    int peak_clients;            // 存活客户端协程的峰值
 } echo_server_t;
 
 /**
@@ -37,6 +88,23 @@ typedef struct echo_server {
  */
 int echo_server_start(int port);
 
+/**
+ * 创建并启动 TCP echo server
+ * @param port 监听端口
+ * @param opts TCP 选项（NULL 使用默认值）
+ * @return 0 成功，-1 失败
+ */
+int echo_server_start_tcp(int port, const echo_tcp_options_t *opts);
+
+/**
+ * 创建并启动 UDP echo server
+ * 每个分片一个 SO_REUSEPORT 套接字和一个线程，由线程上的协程用 recvmmsg/sendmmsg 批量收发
+ * @param port 监听端口
+ * @param opts UDP 选项（NULL 使用默认值）
+ * @return 0 成功，-1 失败
+ */
+int echo_server_start_udp(int port, const echo_udp_options_t *opts);
+
 /**
  * 停止 echo server
  */
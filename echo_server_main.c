@@ -1,22 +1,73 @@
+#define _GNU_SOURCE
 #include "echo_server.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+
+static void usage(const char *prog) {
+    fprintf(stderr, "使用方法: %s [-l] [-q] [-u] [-s 分片数] [-b 批量] [-g] [端口号]\n", prog);
+    fprintf(stderr, "  -l  TCP：先内联处理首次读取，需要挂起时才创建协程\n");
+    fprintf(stderr, "  -q  TCP：不打印每个连接的日志\n");
+    fprintf(stderr, "  -u  UDP 模式（默认 TCP）\n");
+    fprintf(stderr, "  -s  UDP SO_REUSEPORT 套接字数量，每个一个线程（默认 %d）\n", UDP_DEFAULT_SHARDS);
+    fprintf(stderr, "  -b  每次 recvmmsg/sendmmsg 的数据报数（默认 %d）\n", UDP_DEFAULT_BATCH);
+    fprintf(stderr, "  -g  启用 UDP_GRO/UDP_SEGMENT 合并收发\n");
+}
 
 int main(int argc, char *argv[]) {
     int port = DEFAULT_PORT;
+    int udp = 0;
+    echo_tcp_options_t tcp_opts = { 0, 0 };
+    echo_udp_options_t opts = { UDP_DEFAULT_SHARDS, UDP_DEFAULT_BATCH, 0 };
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "lqus:b:g")) != -1) {
+        switch (opt) {
+        case 'l':
+            tcp_opts.lazy = 1;
+            break;
+        case 'q':
+            tcp_opts.quiet = 1;
+            break;
+        case 'u':
+            udp = 1;
+            break;
+        case 's':
+            opts.shards = atoi(optarg);
+            break;
+        case 'b':
+            opts.batch = atoi(optarg);
+            break;
+        case 'g':
+            opts.gso = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
     
-    if (argc > 1) {
-        port = atoi(argv[1]);
+    if (optind < argc) {
+        port = atoi(argv[optind]);
         if (port <= 0 || port > 65535) {
-            fprintf(stderr, "无效的端口号: %s\n", argv[1]);
-            fprintf(stderr, "使用方法: %s [端口号]\n", argv[0]);
+            fprintf(stderr, "无效的端口号: %s\n", argv[optind]);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (udp) {
+        printf("启动 UDP Echo Server，端口: %d\n", port);
+        if (echo_server_start_udp(port, &opts) < 0) {
+            fprintf(stderr, "启动服务器失败\n");
             return 1;
         }
+        return 0;
     }
     
     printf("启动 Echo Server，端口: %d\n", port);
     
-    if (echo_server_start(port) < 0) {
+    if (echo_server_start_tcp(port, &tcp_opts) < 0) {
         fprintf(stderr, "启动服务器失败\n");
         return 1;
     }
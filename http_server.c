@@ -0,0 +1,648 @@
+#define _GNU_SOURCE
+#include "http_server.h"
+#include "coroutine.h"
+#include "reactor.h"
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+static volatile int running = 1;
+
+// ---------------------------------------------------------------------------
+// 预生成的响应：启动时渲染完整的响应报文，Date 头的位置固定，每秒原地改写一次
+// ---------------------------------------------------------------------------
+
+// 响应内容
+enum {
+    HTTP_RESP_HELLO,             // 200 纯文本
+    HTTP_RESP_NOT_FOUND,         // 404
+    HTTP_RESP_BAD_METHOD,        // 405
+    HTTP_RESP_BAD_REQUEST,       // 400（总是关闭连接）
+    HTTP_RESP_TOO_LARGE,         // 431（总是关闭连接）
+    HTTP_RESP_NOT_IMPLEMENTED,   // 501（总是关闭连接）
+    HTTP_RESP_COUNT
+};
+
+// 连接头的三种形式
+enum {
+    HTTP_CONN_KEEP,              // HTTP/1.1 默认保持连接，不带 Connection 头
+    HTTP_CONN_KEEP10,            // HTTP/1.0 显式要求保持连接
+    HTTP_CONN_CLOSE,             // Connection: close
+    HTTP_CONN_COUNT
+};
+
+typedef struct http_response {
+    char data[HTTP_RESPONSE_MAX];
+    size_t len;                  // 完整报文长度
+    size_t head_len;             // 响应头长度（HEAD 请求只发送这部分）
+    size_t date_off;             // Date 值在报文中的偏移
+} http_response_t;
+
+// 每个线程一份，Date 改写不需要加锁
+static _Thread_local http_response_t responses[HTTP_RESP_COUNT][HTTP_CONN_COUNT];
+static _Thread_local time_t date_second = 0;
+
+static const char hello_body[] = "Hello, World!";
+
+static const char *const conn_headers[HTTP_CONN_COUNT] = {
+    "",
+    "Connection: keep-alive\r\n",
+    "Connection: close\r\n",
+};
+
+static void http_format_date(char *buf, time_t t) {
+    struct tm tm;
+    char tmp[HTTP_DATE_LEN + 1];
+    gmtime_r(&t, &tm);
+    strftime(tmp, sizeof(tmp), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    memcpy(buf, tmp, HTTP_DATE_LEN);
+}
+
+static void http_render(http_response_t *r, const char *status, const char *extra,
+                        const char *conn, const char *body) {
+    size_t body_len = strlen(body);
+    int n = snprintf(r->data, sizeof(r->data),
+                     "HTTP/1.1 %s\r\n"
+                     "Server: coroutine\r\n"
+                     "Date: ",
+                     status);
+    r->date_off = n;
+    n += snprintf(r->data + n, sizeof(r->data) - n,
+                  "%*s\r\n"
+                  "Content-Type: text/plain\r\n"
+                  "Content-Length: %zu\r\n"
+                  "%s%s\r\n",
+                  HTTP_DATE_LEN, "", body_len, extra, conn);
+    r->head_len = n;
+    memcpy(r->data + n, body, body_len);
+    r->len = n + body_len;
+}
+
+static void http_responses_init(void) {
+    for (int c = 0; c < HTTP_CONN_COUNT; c++) {
+        // 出错的响应总是关闭连接
+        const char *close = conn_headers[HTTP_CONN_CLOSE];
+        http_render(&responses[HTTP_RESP_HELLO][c], "200 OK", "", conn_headers[c], hello_body);
+        http_render(&responses[HTTP_RESP_NOT_FOUND][c], "404 Not Found", "", conn_headers[c],
+                    "Not Found");
+        http_render(&responses[HTTP_RESP_BAD_METHOD][c], "405 Method Not Allowed",
+                    "Allow: GET, HEAD\r\n", conn_headers[c], "Method Not Allowed");
+        http_render(&responses[HTTP_RESP_BAD_REQUEST][c], "400 Bad Request", "", close,
+                    "Bad Request");
+        http_render(&responses[HTTP_RESP_TOO_LARGE][c], "431 Request Header Fields Too Large",
+                    "", close, "Request Header Fields Too Large");
+        http_render(&responses[HTTP_RESP_NOT_IMPLEMENTED][c], "501 Not Implemented", "", close,
+                    "Not Implemented");
+    }
+    date_second = 0;
+}
+
+// 秒数变化时改写所有预生成响应中的 Date
+static void http_date_refresh(void) {
+    time_t now = time(NULL);
+    if (now == date_second) {
+        return;
+    }
+    date_second = now;
+    
+    char date[HTTP_DATE_LEN];
+    http_format_date(date, now);
+    for (int i = 0; i < HTTP_RESP_COUNT; i++) {
+        for (int c = 0; c < HTTP_CONN_COUNT; c++) {
+            memcpy(responses[i][c].data + responses[i][c].date_off, date, HTTP_DATE_LEN);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 请求解析
+// ---------------------------------------------------------------------------
+
+// 在 [s, e) 中查找逗号分隔的 token（不区分大小写）
+static int header_has_token(const char *s, const char *e, const char *tok, size_t n) {
+    while (s < e) {
+        while (s < e && (*s == ' ' || *s == '\t' || *s == ',')) {
+            s++;
+        }
+        const char *t = s;
+        while (s < e && *s != ',' && *s != ' ' && *s != '\t') {
+            s++;
+        }
+        if ((size_t)(s - t) == n && strncasecmp(t, tok, n) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#define NAME_IS(name, n, lit) ((n) == sizeof(lit) - 1 && strncasecmp((name), (lit), (n)) == 0)
+
+int http_parse_request(const char *buf, size_t len, size_t *scanned, http_request_t *req) {
+    // 从上次扫描结束处（回退3字节以防 \r\n\r\n 被拆开）继续查找请求头结尾
+    size_t from = *scanned > 3 ? *scanned - 3 : 0;
+    const char *end = NULL;
+    for (const char *p = buf + from; p + 4 <= buf + len; ) {
+        p = (const char *)memchr(p, '\r', buf + len - p);
+        if (p == NULL || p + 4 > buf + len) {
+            break;
+        }
+        if (p[1] == '\n' && p[2] == '\r' && p[3] == '\n') {
+            end = p + 4;
+            break;
+        }
+        p++;
+    }
+    if (end == NULL) {
+        *scanned = len;
+        return 0;
+    }
+    
+    // 请求行：<method> SP <target> SP HTTP/1.<d> CRLF
+    const char *p = buf;
+    const char *line_end = (const char *)memchr(p, '\r', end - p);
+    const char *sp = (const char *)memchr(p, ' ', line_end - p);
+    if (sp == NULL || sp == p) {
+        return -1;
+    }
+    req->method = p;
+    req->method_len = sp - p;
+    
+    p = sp + 1;
+    sp = (const char *)memchr(p, ' ', line_end - p);
+    if (sp == NULL || sp == p || line_end - sp != 9 || memcmp(sp + 1, "HTTP/1.", 7) != 0 ||
+        (sp[8] != '0' && sp[8] != '1')) {
+        return -1;
+    }
+    const char *q = (const char *)memchr(p, '?', sp - p);
+    req->path = p;
+    req->path_len = (q != NULL ? q : sp) - p;
+    req->minor_version = sp[8] - '0';
+    req->keep_alive = req->minor_version == 1;
+    req->content_length = 0;
+    req->chunked = 0;
+    
+    // 请求头：只关心 Connection、Content-Length 和 Transfer-Encoding
+    p = line_end + 2;
+    while (p < end - 2) {
+        line_end = (const char *)memchr(p, '\r', end - p);
+        const char *colon = (const char *)memchr(p, ':', line_end - p);
+        if (colon == NULL || colon == p) {
+            return -1;
+        }
+        size_t name_len = colon - p;
+        const char *v = colon + 1;
+        while (v < line_end && (*v == ' ' || *v == '\t')) {
+            v++;
+        }
+        
+        if (NAME_IS(p, name_len, "Connection")) {
+            if (header_has_token(v, line_end, "close", 5)) {
+                req->keep_alive = 0;
+            } else if (header_has_token(v, line_end, "keep-alive", 10)) {
+                req->keep_alive = 1;
+            }
+        } else if (NAME_IS(p, name_len, "Content-Length")) {
+            size_t n = 0;
+            if (v == line_end) {
+                return -1;
+            }
+            for (const char *d = v; d < line_end; d++) {
+                if (*d < '0' || *d > '9' || n > SIZE_MAX / 10 - 1) {
+                    return -1;
+                }
+                n = n * 10 + (*d - '0');
+            }
+            req->content_length = n;
+        } else if (NAME_IS(p, name_len, "Transfer-Encoding")) {
+            req->chunked = header_has_token(v, line_end, "chunked", 7);
+        }
+        p = line_end + 2;
+    }
+    
+    return (int)(end - buf);
+}
+
+// ---------------------------------------------------------------------------
+// 连接处理
+// ---------------------------------------------------------------------------
+
+// 连接状态，从连接协程的 arena 中分配
+typedef struct http_conn {
+    int fd;
+    http_worker_t *w;
+    char *in;
+    size_t in_len;
+    size_t scanned;              // 队首请求已扫描的长度
+    size_t discard;              // 待丢弃的请求体字节数
+    int64_t deadline;            // 未读完的请求必须在此之前到齐（毫秒，单调时钟），-1 表示没有
+    int completed;               // 本轮处理了完整的请求头
+    char *out;
+    size_t out_len;
+    int closing;                 // 发送完已累积的响应后关闭
+} http_conn_t;
+
+// 连接协程的启动参数，只在协程首次挂起之前有效
+typedef struct http_conn_start {
+    int fd;
+    http_worker_t *w;
+} http_conn_start_t;
+
+static int http_flush(http_conn_t *c) {
+    if (c->out_len == 0) {
+        return 0;
+    }
+    c->w->flushes++;
+    // 只流水线发送、从不读取的客户端会让发送缓冲区一直满着：等待可写同样受空闲超时限制
+    int r = net_send_all_timeout(c->fd, c->out, c->out_len, c->w->idle_timeout_ms);
+    if (r < 0 && errno == ETIMEDOUT) {
+        c->w->timeouts++;
+    }
+    c->out_len = 0;
+    return r;
+}
+
+static int http_respond(http_conn_t *c, int resp, int conn, int head_only) {
+    const http_response_t *r = &responses[resp][conn];
+    size_t len = head_only ? r->head_len : r->len;
+    if (c->out_len + len > HTTP_WRITE_BUFFER && http_flush(c) < 0) {
+        return -1;
+    }
+    memcpy(c->out + c->out_len, r->data, len);
+    c->out_len += len;
+    return 0;
+}
+
+// 选择请求对应的预生成响应
+static int http_route(const http_request_t *req, int *head_only) {
+    *head_only = 0;
+    if (req->method_len == 4 && memcmp(req->method, "HEAD", 4) == 0) {
+        *head_only = 1;
+    } else if (!(req->method_len == 3 && memcmp(req->method, "GET", 3) == 0)) {
+        return HTTP_RESP_BAD_METHOD;
+    }
+    if ((req->path_len == 1 && req->path[0] == '/') ||
+        (req->path_len == 10 && memcmp(req->path, "/plaintext", 10) == 0)) {
+        return HTTP_RESP_HELLO;
+    }
+    return HTTP_RESP_NOT_FOUND;
+}
+
+// 处理接收缓冲区中所有完整的请求（流水线），剩余部分移到缓冲区开头
+// @return 0 继续，-1 发送失败
+static int http_process(http_conn_t *c) {
+    size_t p = 0;
+    
+    http_date_refresh();
+    while (p < c->in_len && !c->closing) {
+        if (c->discard > 0) {
+            size_t skip = c->in_len - p < c->discard ? c->in_len - p : c->discard;
+            p += skip;
+            c->discard -= skip;
+            continue;
+        }
+        
+        http_request_t req;
+        int n = http_parse_request(c->in + p, c->in_len - p, &c->scanned, &req);
+        if (n == 0) {
+            if (c->in_len - p == HTTP_READ_BUFFER) {
+                c->w->bad_requests++;
+                c->closing = 1;
+                return http_respond(c, HTTP_RESP_TOO_LARGE, HTTP_CONN_CLOSE, 0);
+            }
+            break;
+        }
+        if (n < 0) {
+            c->w->bad_requests++;
+            c->closing = 1;
+            return http_respond(c, HTTP_RESP_BAD_REQUEST, HTTP_CONN_CLOSE, 0);
+        }
+        
+        p += n;
+        c->scanned = 0;
+        c->completed = 1;
+        c->w->requests++;
+        
+        if (req.chunked) {
+            // 无法确定请求体的边界，只能关闭连接
+            c->w->bad_requests++;
+            c->closing = 1;
+            return http_respond(c, HTTP_RESP_NOT_IMPLEMENTED, HTTP_CONN_CLOSE, 0);
+        }
+        c->discard = req.content_length;
+        
+        int head_only;
+        int resp = http_route(&req, &head_only);
+        int conn = !req.keep_alive ? HTTP_CONN_CLOSE :
+                   (req.minor_version == 0 ? HTTP_CONN_KEEP10 : HTTP_CONN_KEEP);
+        c->closing = !req.keep_alive;
+        if (http_respond(c, resp, conn, head_only) < 0) {
+            return -1;
+        }
+    }
+    
+    c->in_len -= p;
+    if (c->in_len > 0 && p > 0) {
+        memmove(c->in, c->in + p, c->in_len);
+    }
+    return 0;
+}
+
+// 请求头（及要丢弃的请求体）从第一个字节到达起计时，读完整个请求后清除；
+// 否则逐字节发送的客户端每次都会重置空闲计时，永远不会被关闭。
+// 请求体可能在之后的某次读取中才丢弃完（此时没有新的请求头），同样要清除
+static void http_update_deadline(http_conn_t *c) {
+    if (c->completed || (c->in_len == 0 && c->discard == 0)) {
+        c->deadline = -1;
+    }
+    if ((c->in_len > 0 || c->discard > 0) && c->deadline < 0) {
+        c->deadline = reactor_now_ms() + c->w->idle_timeout_ms;
+    }
+}
+
+// 下一次等待可读的超时：有未读完的请求时为剩余时间，否则为空闲超时
+static int http_wait_ms(const http_conn_t *c) {
+    if (c->deadline < 0) {
+        return c->w->idle_timeout_ms;
+    }
+    int64_t left = c->deadline - reactor_now_ms();
+    return left > 0 ? (int)left : 0;
+}
+
+// 服务器主动关闭（错误响应或 Connection: close）：套接字里还有未读的请求数据时直接 close
+// 会让内核发送 RST，客户端可能收不到刚发出的响应。先半关闭，再在限定时间内读空输入
+static void http_lingering_close(http_conn_t *c) {
+    if (shutdown(c->fd, SHUT_WR) < 0) {
+        return;
+    }
+    int64_t deadline = reactor_now_ms() + HTTP_LINGER_MS;
+    for (;;) {
+        int64_t left = deadline - reactor_now_ms();
+        if (left <= 0) {
+            return;
+        }
+        ssize_t n = recv(c->fd, c->in, HTTP_READ_BUFFER, 0);
+        if (n > 0 || (n < 0 && errno == EINTR)) {
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK) ||
+            reactor_wait_timeout(c->fd, EPOLLIN, (int)left) != 0) {
+            return;
+        }
+    }
+}
+
+// 连接协程：读到 EAGAIN 为止处理所有流水线请求，挂起前一次性发送全部响应
+static void http_conn_handler(void *arg) {
+    const http_conn_start_t *start = (const http_conn_start_t *)arg;
+    int fd = start->fd;
+    
+    http_conn_t *c = (http_conn_t *)co_alloc(sizeof(http_conn_t));
+    char *in = (char *)co_alloc(HTTP_READ_BUFFER);
+    char *out = (char *)co_alloc(HTTP_WRITE_BUFFER);
+    if (c == NULL || in == NULL || out == NULL) {
+        perror("co_alloc http_conn error");
+        goto out;
+    }
+    memset(c, 0, sizeof(*c));
+    c->fd = fd;
+    c->w = start->w;
+    c->deadline = -1;
+    c->in = in;
+    c->out = out;
+    
+    while (!c->closing) {
+        ssize_t n = recv(fd, c->in + c->in_len, HTTP_READ_BUFFER - c->in_len, 0);
+        if (n > 0) {
+            c->in_len += n;
+            c->completed = 0;
+            if (http_process(c) < 0) {
+                goto out;
+            }
+            http_update_deadline(c);
+            continue;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // 本轮请求已全部处理，合并发送后等待下一批（空闲过久则关闭）
+            if (http_flush(c) < 0) {
+                goto out;
+            }
+            int r = reactor_wait_timeout(fd, EPOLLIN, http_wait_ms(c));
+            if (r < 0) {
+                // 等待失败时再 recv 只会反复得到 EAGAIN，空转不让出
+                perror("reactor_wait_timeout error");
+                break;
+            }
+            if (r == 1) {
+                c->w->timeouts++;
+                break;
+            }
+            continue;
+        }
+        if (errno != EINTR) {
+            break;
+        }
+    }
+    
+    if (http_flush(c) == 0 && c->closing) {
+        http_lingering_close(c);
+    }
+    
+out:
+    reactor_remove(fd);
+    close(fd);
+}
+
+// 接受连接的协程：每个工作线程一个，只接受自己的 SO_REUSEPORT 套接字上的连接
+static void http_accept_handler(void *arg) {
+    http_worker_t *w = (http_worker_t *)arg;
+    
+    while (running) {
+        int fd = accept4(w->listen_fd, NULL, NULL, SOCK_NONBLOCK);
+        if (fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (reactor_wait(w->listen_fd, EPOLLIN) < 0) {
+                    perror("reactor_wait error");
+                    break;
+                }
+                continue;
+            } else if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            } else if (errno == EMFILE || errno == ENFILE) {
+                // 描述符耗尽：稍后重试，不退出接受循环
+                perror("accept error");
+                if (reactor_wait_timeout(w->listen_fd, EPOLLIN, 100) < 0) {
+                    perror("reactor_wait_timeout error");
+                    break;
+                }
+                continue;
+            }
+            perror("accept error");
+            break;
+        }
+        
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        
+        http_conn_start_t start = { fd, w };
+        coroutine_t *co = coroutine_create_arena(http_conn_handler, &start,
+                                                 HTTP_CONN_STACK_SIZE, HTTP_CONN_ARENA_SIZE);
+        if (co == NULL) {
+            perror("coroutine_create error");
+            close(fd);
+            continue;
+        }
+        coroutine_detach(co);
+        
+        if (reactor_add(fd) < 0) {
+            coroutine_destroy(co);
+            close(fd);
+            continue;
+        }
+        
+        w->conns++;
+        
+        // start 在连接协程第一次挂起之前保持有效
+        coroutine_resume(co);
+    }
+}
+
+// 工作线程：私有的 reactor、协程运行时和预生成响应
+static void *http_worker_main(void *arg) {
+    http_worker_t *w = (http_worker_t *)arg;
+    
+    http_responses_init();
+    if (reactor_init() < 0) {
+        return NULL;
+    }
+    if (reactor_add(w->listen_fd) < 0) {
+        reactor_destroy();
+        return NULL;
+    }
+    
+    coroutine_t *co = coroutine_create(http_accept_handler, w, 64 * 1024);
+    if (co == NULL) {
+        perror("coroutine_create http_accept_handler error");
+        reactor_destroy();
+        coroutine_thread_exit();
+        return NULL;
+    }
+    coroutine_handle_t accept_co = coroutine_handle(co);
+    coroutine_resume(co);
+    
+    reactor_run(&running);
+    
+    coroutine_destroy(coroutine_lookup(accept_co));
+    reactor_remove(w->listen_fd);
+    reactor_destroy();
+    coroutine_thread_exit();
+    return NULL;
+}
+
+// 信号处理函数
+static void signal_handler(int sig) {
+    if (sig == SIGINT || sig == SIGTERM) {
+        printf("\n收到停止信号，正在关闭服务器...\n");
+        running = 0;
+    }
+}
+
+static void http_print_stats(http_worker_t *workers, int nthreads) {
+    uint64_t conns = 0, requests = 0, flushes = 0, timeouts = 0, bad = 0;
+    
+    for (int i = 0; i < nthreads; i++) {
+        http_worker_t *w = &workers[i];
+        printf("  线程 %d: 连接 %llu 个，请求 %llu 个\n", w->id,
+               (unsigned long long)w->conns, (unsigned long long)w->requests);
+        conns += w->conns;
+        requests += w->requests;
+        flushes += w->flushes;
+        timeouts += w->timeouts;
+        bad += w->bad_requests;
+    }
+    
+    printf("连接 %llu 个（空闲超时关闭 %llu 个），请求 %llu 个（错误 %llu 个）",
+           (unsigned long long)conns, (unsigned long long)timeouts,
+           (unsigned long long)requests, (unsigned long long)bad);
+    if (flushes > 0) {
+        printf("，平均每次发送合并 %.1f 个响应", (double)requests / flushes);
+    }
+    printf("\n");
+}
+
+int http_server_start(const http_server_options_t *opts) {
+    if (opts->threads <= 0 || opts->threads > HTTP_MAX_THREADS || opts->idle_timeout_ms <= 0) {
+        fprintf(stderr, "无效的选项: threads=%d idle=%d ms\n", opts->threads, opts->idle_timeout_ms);
+        return -1;
+    }
+    
+    http_worker_t *workers = (http_worker_t *)aligned_alloc(64, sizeof(http_worker_t) * opts->threads);
+    if (workers == NULL) {
+        perror("malloc workers error");
+        return -1;
+    }
+    memset(workers, 0, sizeof(http_worker_t) * opts->threads);
+    
+    // 在主线程创建所有监听套接字，端口被占用等错误在启动时立即报告
+    for (int i = 0; i < opts->threads; i++) {
+        workers[i].id = i;
+        workers[i].idle_timeout_ms = opts->idle_timeout_ms;
+        workers[i].listen_fd = net_listen_tcp(opts->port, HTTP_BACKLOG, 1);
+        if (workers[i].listen_fd < 0) {
+            for (int j = 0; j < i; j++) {
+                close(workers[j].listen_fd);
+            }
+            free(workers);
+            return -1;
+        }
+    }
+    
+    // 工作线程屏蔽信号，由主线程处理停止请求
+    int nstarted = 0;
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (int i = 0; i < opts->threads; i++) {
+        if (pthread_create(&workers[i].thread, NULL, http_worker_main, &workers[i]) != 0) {
+            perror("pthread_create error");
+            running = 0;
+            break;
+        }
+        nstarted++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+    
+    printf("=== HTTP Server 启动 ===\n");
+    printf("监听端口: %d，工作线程: %d，空闲超时: %d ms\n",
+           opts->port, opts->threads, opts->idle_timeout_ms);
+    printf("按 Ctrl+C 停止服务器\n\n");
+    
+    for (int i = 0; i < nstarted; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    
+    http_print_stats(workers, opts->threads);
+    
+    for (int i = 0; i < opts->threads; i++) {
+        close(workers[i].listen_fd);
+    }
+    free(workers);
+    
+    printf("服务器已关闭\n");
+    return nstarted == opts->threads ? 0 : -1;
+}
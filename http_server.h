@@ -0,0 +1,75 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// 服务器配置
+#define HTTP_DEFAULT_PORT 8080
+#define HTTP_MAX_THREADS 64
+#define HTTP_BACKLOG 4096
+#define HTTP_CONN_STACK_SIZE (32 * 1024)   // 连接协程栈大小
+#define HTTP_CONN_ARENA_SIZE (20 * 1024)   // 连接协程 arena（连接结构和收发缓冲区）
+#define HTTP_READ_BUFFER 8192              // 接收缓冲区，也是请求头的最大长度
+#define HTTP_WRITE_BUFFER 8192             // 发送缓冲区，放不下时先发送已累积的响应
+#define HTTP_DEFAULT_IDLE_MS 5000          // 连接空闲（或请求头未收完）的超时
+#define HTTP_LINGER_MS 1000                // 服务器主动关闭时最多丢弃未读请求数据的时间
+#define HTTP_DATE_LEN 29                   // "Sun, 06 Nov 1994 08:49:37 GMT"
+#define HTTP_RESPONSE_MAX 512              // 单个预生成响应的最大长度
+
+// 解析出的请求，字段直接指向接收缓冲区
+typedef struct http_request {
+    const char *method;
+    size_t method_len;
+    const char *path;            // 不含查询串
+    size_t path_len;
+    int minor_version;           // HTTP/1.x 的 x
+    int keep_alive;              // 响应后是否保持连接
+    size_t content_length;       // 请求体长度（读完后丢弃）
+    int chunked;                 // Transfer-Encoding: chunked（不支持）
+} http_request_t;
+
+// 服务器选项
+typedef struct http_server_options {
+    int port;                    // 监听端口
+    int threads;                 // 工作线程数，每个线程一个 reactor 和一个 SO_REUSEPORT 套接字
+    int idle_timeout_ms;         // 空闲连接超时（毫秒）
+} http_server_options_t;
+
+// 工作线程：私有的 reactor、监听套接字和统计
+typedef struct http_worker {
+    _Alignas(64)
+    int id;
+    int listen_fd;
+    int idle_timeout_ms;
+    pthread_t thread;
+    
+    // 统计（只由本线程写）
+    uint64_t conns;              // 接受的连接数
+    uint64_t requests;           // 处理的请求数
+    uint64_t flushes;            // 批量发送次数
+    uint64_t timeouts;           // 因空闲超时关闭的连接数
+    uint64_t bad_requests;       // 格式错误或不支持的请求
+} http_worker_t;
+
+/**
+ * 增量解析请求头
+ * 请求头被拆在多次读取中时返回0，并在 *scanned 中记录已扫描的长度，
+ * 下次调用只扫描新到达的数据
+ * @param buf 以请求行开头的数据
+ * @param len 数据长度
+ * @param scanned 已扫描过的字节数（新请求从0开始）
+ * @param req 解析结果
+ * @return 请求头长度（含结尾空行），0 表示不完整，-1 表示格式错误
+ */
+int http_parse_request(const char *buf, size_t len, size_t *scanned, http_request_t *req);
+
+/**
+ * 启动 HTTP/1.1 服务器，阻塞直到收到停止信号
+ * @param opts 服务器选项
+ * @return 0 成功，-1 失败
+ */
+int http_server_start(const http_server_options_t *opts);
+
+#endif // HTTP_SERVER_H
@@ -0,0 +1,53 @@
+#define _GNU_SOURCE
+#include "http_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void usage(const char *prog) {
+    fprintf(stderr, "使用方法: %s [-t 线程数] [-i 空闲超时ms] [端口号]\n", prog);
+    fprintf(stderr, "  -t  工作线程数（默认 CPU 数，最多 %d）\n", HTTP_MAX_THREADS);
+    fprintf(stderr, "  -i  空闲连接超时（默认 %d ms）\n", HTTP_DEFAULT_IDLE_MS);
+}
+
+int main(int argc, char *argv[]) {
+    http_server_options_t opts = { HTTP_DEFAULT_PORT, 1, HTTP_DEFAULT_IDLE_MS };
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    
+    if (ncpu > 0) {
+        opts.threads = ncpu < HTTP_MAX_THREADS ? (int)ncpu : HTTP_MAX_THREADS;
+    }
+    
+    while ((opt = getopt(argc, argv, "t:i:")) != -1) {
+        switch (opt) {
+        case 't':
+            opts.threads = atoi(optarg);
+            break;
+        case 'i':
+            opts.idle_timeout_ms = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (optind < argc) {
+        opts.port = atoi(argv[optind]);
+        if (opts.port <= 0 || opts.port > 65535) {
+            fprintf(stderr, "无效的端口号: %s\n", argv[optind]);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    printf("启动 HTTP Server，端口: %d\n", opts.port);
+    
+    if (http_server_start(&opts) < 0) {
+        fprintf(stderr, "启动服务器失败\n");
+        return 1;
+    }
+    
+    return 0;
+}
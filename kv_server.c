@@ -0,0 +1,691 @@
+#define _GNU_SOURCE
+#include "kv_server.h"
+#include "reactor.h"
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+static volatile int running = 1;
+
+// 缓冲区：初始空间来自协程 arena，不够时换成 malloc 的空间
+typedef struct kv_buf {
+    char *data;
+    size_t len;
+    size_t cap;
+    int heap;                    // data 是否由 malloc 分配
+} kv_buf_t;
+
+// 连接状态，从连接协程的 arena 中分配
+typedef struct kv_conn {
+    int fd;
+    kv_worker_t *w;
+    kv_buf_t in;                 // 未处理的请求数据
+    kv_buf_t out;                // 待发送的响应（一轮读取内的所有响应合并发送）
+    size_t need;                 // 队首命令完整到达所需的字节数（set 的数据块）
+    size_t swallow;              // 需要丢弃的字节数（过大的 set 数据块）
+    int error;                   // 缓冲区分配失败
+} kv_conn_t;
+
+// 连接协程的启动参数，只在协程首次挂起之前有效
+typedef struct kv_conn_start {
+    int fd;
+    kv_worker_t *w;
+} kv_conn_start_t;
+
+// 请求中的一个参数，直接指向接收缓冲区（不复制）
+typedef struct kv_token {
+    const char *s;
+    size_t n;
+} kv_token_t;
+
+static int buf_reserve(kv_buf_t *b, size_t extra) {
+    if (b->cap - b->len >= extra) {
+        return 0;
+    }
+    size_t cap = b->cap * 2;
+    if (cap < b->len + extra) {
+        cap = b->len + extra;
+    }
+    
+    char *p;
+    if (b->heap) {
+        p = (char *)realloc(b->data, cap);
+    } else {
+        p = (char *)malloc(cap);
+        if (p != NULL) {
+            memcpy(p, b->data, b->len);
+        }
+    }
+    if (p == NULL) {
+        return -1;
+    }
+    b->data = p;
+    b->cap = cap;
+    b->heap = 1;
+    return 0;
+}
+
+static void out_append(kv_conn_t *c, const char *s, size_t n) {
+    if (buf_reserve(&c->out, n) < 0) {
+        c->error = 1;
+        return;
+    }
+    memcpy(c->out.data + c->out.len, s, n);
+    c->out.len += n;
+}
+
+#define OUT_LITERAL(c, lit) out_append((c), (lit), sizeof(lit) - 1)
+
+// 无符号整数转十进制，返回长度
+static size_t u64_to_str(char *buf, uint64_t v) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    for (size_t i = 0; i < n; i++) {
+        buf[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+static int parse_u64(const kv_token_t *t, uint64_t *out) {
+    if (t->n == 0 || t->n > 20) {
+        return -1;
+    }
+    uint64_t v = 0;
+    for (size_t i = 0; i < t->n; i++) {
+        unsigned d = (unsigned char)t->s[i] - '0';
+        if (d > 9 || v > (UINT64_MAX - d) / 10) {
+            return -1;
+        }
+        v = v * 10 + d;
+    }
+    *out = v;
+    return 0;
+}
+
+static int parse_i64(const kv_token_t *t, int64_t *out) {
+    kv_token_t digits = *t;
+    int neg = t->n > 0 && t->s[0] == '-';
+    if (neg) {
+        digits.s++;
+        digits.n--;
+    }
+    uint64_t v;
+    if (parse_u64(&digits, &v) < 0 || v > INT64_MAX) {
+        return -1;
+    }
+    *out = neg ? -(int64_t)v : (int64_t)v;
+    return 0;
+}
+
+static inline int token_is(const kv_token_t *t, const char *lit, size_t n) {
+    return t->n == n && memcmp(t->s, lit, n) == 0;
+}
+
+#define TOKEN_IS(t, lit) token_is((t), (lit), sizeof(lit) - 1)
+
+// 切出下一个以空格分隔的参数，没有时返回0
+static int next_token(const char **s, const char *e, kv_token_t *t) {
+    const char *p = *s;
+    while (p < e && *p == ' ') {
+        p++;
+    }
+    if (p == e) {
+        return 0;
+    }
+    t->s = p;
+    while (p < e && *p != ' ') {
+        p++;
+    }
+    t->n = p - t->s;
+    *s = p;
+    return 1;
+}
+
+// 把剩余参数切入数组，返回个数；超过 max 时返回 -1
+static int split_tokens(const char *s, const char *e, kv_token_t *tokens, int max) {
+    int n = 0;
+    kv_token_t t;
+    while (next_token(&s, e, &t)) {
+        if (n == max) {
+            return -1;
+        }
+        tokens[n++] = t;
+    }
+    return n;
+}
+
+// get 命中：写入 "VALUE <key> <flags> <bytes>\r\n<data>\r\n"（在分片锁内调用）
+static void get_value_cb(void *ctx, const char *key, size_t nkey,
+                         uint32_t flags, const char *data, size_t nbytes) {
+    kv_conn_t *c = (kv_conn_t *)ctx;
+    if (buf_reserve(&c->out, nkey + nbytes + 64) < 0) {
+        c->error = 1;
+        return;
+    }
+    char *p = c->out.data + c->out.len;
+    memcpy(p, "VALUE ", 6);
+    p += 6;
+    memcpy(p, key, nkey);
+    p += nkey;
+    *p++ = ' ';
+    p += u64_to_str(p, flags);
+    *p++ = ' ';
+    p += u64_to_str(p, nbytes);
+    *p++ = '\r';
+    *p++ = '\n';
+    memcpy(p, data, nbytes);
+    p += nbytes;
+    *p++ = '\r';
+    *p++ = '\n';
+    c->out.len = p - c->out.data;
+}
+
+static void cmd_get(kv_conn_t *c, const char *s, const char *e) {
+    // 先检查所有键：出错时只能输出 CLIENT_ERROR，不能混在已经写出的 VALUE 之后
+    const char *p = s;
+    kv_token_t key;
+    int nkeys = 0;
+    while (next_token(&p, e, &key)) {
+        if (key.n > KV_MAX_KEY_LEN) {
+            OUT_LITERAL(c, "CLIENT_ERROR bad command line format\r\n");
+            return;
+        }
+        nkeys++;
+    }
+    if (nkeys == 0) {
+        OUT_LITERAL(c, "ERROR\r\n");
+        return;
+    }
+    
+    while (next_token(&s, e, &key)) {
+        if (kv_get(c->w->store, key.s, key.n, get_value_cb, c) == KV_OK) {
+            c->w->get_hits++;
+        } else {
+            c->w->get_misses++;
+        }
+    }
+    OUT_LITERAL(c, "END\r\n");
+}
+
+// set <key> <flags> <exptime> <bytes> [noreply]\r\n<data>\r\n
+// 返回消耗的字节数，数据块未到齐时返回0
+static size_t cmd_set(kv_conn_t *c, const char *s, const char *e,
+                      const char *line, size_t line_total, const char *end) {
+    kv_token_t t[5];
+    int n = split_tokens(s, e, t, 5);
+    uint64_t flags, bytes;
+    int64_t exptime;
+    
+    if ((n != 4 && n != 5) || t[0].n > KV_MAX_KEY_LEN ||
+        parse_u64(&t[1], &flags) < 0 || flags > UINT32_MAX ||
+        parse_i64(&t[2], &exptime) < 0 || parse_u64(&t[3], &bytes) < 0) {
+        OUT_LITERAL(c, "CLIENT_ERROR bad command line format\r\n");
+        return line_total;
+    }
+    int noreply = n == 5 && TOKEN_IS(&t[4], "noreply");
+    
+    if (bytes > KV_PAGE_SIZE) {
+        // 不缓存过大的数据块，到达后直接丢弃
+        OUT_LITERAL(c, "SERVER_ERROR object too large for cache\r\n");
+        c->swallow = bytes + 2;
+        return line_total;
+    }
+    
+    size_t total = line_total + bytes + 2;
+    if ((size_t)(end - line) < total) {
+        c->need = total;
+        return 0;
+    }
+    
+    const char *data = line + line_total;
+    if (data[bytes] != '\r' || data[bytes + 1] != '\n') {
+        OUT_LITERAL(c, "CLIENT_ERROR bad data chunk\r\n");
+        return total;
+    }
+    
+    c->w->sets++;
+    kv_status_t st = kv_set(c->w->store, t[0].s, t[0].n, (uint32_t)flags, exptime, data, bytes);
+    if (noreply) {
+        return total;
+    }
+    if (st == KV_OK) {
+        OUT_LITERAL(c, "STORED\r\n");
+    } else if (st == KV_TOO_LARGE) {
+        OUT_LITERAL(c, "SERVER_ERROR object too large for cache\r\n");
+    } else {
+        OUT_LITERAL(c, "SERVER_ERROR out of memory storing object\r\n");
+    }
+    return total;
+}
+
+// delete <key> [0] [noreply]：旧版客户端仍会带上时间参数，只接受 0
+static void cmd_delete(kv_conn_t *c, const char *s, const char *e) {
+    kv_token_t t[3];
+    int n = split_tokens(s, e, t, 3);
+    int arg = 1;
+    if (n >= 2 && TOKEN_IS(&t[1], "0")) {
+        arg = 2;
+    }
+    int noreply = n == arg + 1 && TOKEN_IS(&t[arg], "noreply");
+    if (n < 1 || t[0].n > KV_MAX_KEY_LEN || n != arg + noreply) {
+        OUT_LITERAL(c, "CLIENT_ERROR bad command line format\r\n");
+        return;
+    }
+    kv_status_t st = kv_delete(c->w->store, t[0].s, t[0].n);
+    if (noreply) {
+        return;
+    }
+    if (st == KV_OK) {
+        OUT_LITERAL(c, "DELETED\r\n");
+    } else {
+        OUT_LITERAL(c, "NOT_FOUND\r\n");
+    }
+}
+
+static void cmd_incr(kv_conn_t *c, const char *s, const char *e, int decr) {
+    kv_token_t t[3];
+    int n = split_tokens(s, e, t, 3);
+    uint64_t delta, value;
+    if (n < 2 || t[0].n > KV_MAX_KEY_LEN) {
+        OUT_LITERAL(c, "ERROR\r\n");
+        return;
+    }
+    if (parse_u64(&t[1], &delta) < 0) {
+        OUT_LITERAL(c, "CLIENT_ERROR invalid numeric delta argument\r\n");
+        return;
+    }
+    
+    kv_status_t st = kv_incr(c->w->store, t[0].s, t[0].n, delta, decr, &value);
+    if (n == 3 && TOKEN_IS(&t[2], "noreply")) {
+        return;
+    }
+    if (st == KV_OK) {
+        char num[24];
+        size_t len = u64_to_str(num, value);
+        num[len++] = '\r';
+        num[len++] = '\n';
+        out_append(c, num, len);
+    } else if (st == KV_NOT_FOUND) {
+        OUT_LITERAL(c, "NOT_FOUND\r\n");
+    } else if (st == KV_NOT_NUMBER) {
+        OUT_LITERAL(c, "CLIENT_ERROR cannot increment or decrement non-numeric value\r\n");
+    } else {
+        OUT_LITERAL(c, "SERVER_ERROR out of memory\r\n");
+    }
+}
+
+// 处理缓冲区开头的一条命令（line 到 nl 为命令行）
+// 返回消耗的字节数；数据未到齐返回0；连接需要关闭返回 SIZE_MAX
+static size_t kv_command(kv_conn_t *c, const char *line, const char *nl, const char *end) {
+    size_t line_total = nl + 1 - line;
+    const char *e = nl;
+    if (e > line && e[-1] == '\r') {
+        e--;
+    }
+    
+    const char *s = line;
+    kv_token_t cmd;
+    if (!next_token(&s, e, &cmd)) {
+        OUT_LITERAL(c, "ERROR\r\n");
+        return line_total;
+    }
+    
+    c->w->commands++;
+    if (TOKEN_IS(&cmd, "get")) {
+        cmd_get(c, s, e);
+    } else if (TOKEN_IS(&cmd, "set")) {
+        return cmd_set(c, s, e, line, line_total, end);
+    } else if (TOKEN_IS(&cmd, "delete")) {
+        cmd_delete(c, s, e);
+    } else if (TOKEN_IS(&cmd, "incr")) {
+        cmd_incr(c, s, e, 0);
+    } else if (TOKEN_IS(&cmd, "decr")) {
+        cmd_incr(c, s, e, 1);
+    } else if (TOKEN_IS(&cmd, "version")) {
+        OUT_LITERAL(c, "VERSION " KV_VERSION "\r\n");
+    } else if (TOKEN_IS(&cmd, "quit")) {
+        return SIZE_MAX;
+    } else {
+        OUT_LITERAL(c, "ERROR\r\n");
+    }
+    return line_total;
+}
+
+// 发送累积的响应
+static int kv_flush(kv_conn_t *c) {
+    if (c->out.len == 0) {
+        return 0;
+    }
+    c->w->flushes++;
+    int r = net_send_all(c->fd, c->out.data, c->out.len);
+    c->out.len = 0;
+    return r;
+}
+
+// 处理接收缓冲区中所有完整的命令（流水线），剩余部分移到缓冲区开头
+// @return 0 继续，-1 关闭连接
+static int kv_process(kv_conn_t *c) {
+    char *p = c->in.data;
+    char *end = p + c->in.len;
+    int rc = 0;
+    
+    c->need = 0;
+    while (p < end) {
+        if (c->swallow > 0) {
+            size_t skip = (size_t)(end - p) < c->swallow ? (size_t)(end - p) : c->swallow;
+            p += skip;
+            c->swallow -= skip;
+            continue;
+        }
+        
+        char *nl = (char *)memchr(p, '\n', end - p);
+        if (nl == NULL) {
+            if (end - p > KV_MAX_LINE) {
+                OUT_LITERAL(c, "CLIENT_ERROR line too long\r\n");
+                rc = -1;
+            }
+            break;
+        }
+        
+        size_t used = kv_command(c, p, nl, end);
+        if (used == SIZE_MAX) {
+            rc = -1;
+            break;
+        }
+        if (used == 0) {
+            break;
+        }
+        p += used;
+        
+        if (c->error) {
+            rc = -1;
+            break;
+        }
+        if (c->out.len >= KV_FLUSH_THRESHOLD && kv_flush(c) < 0) {
+            rc = -1;
+            break;
+        }
+    }
+    
+    c->in.len = end - p;
+    if (c->in.len > 0 && p != c->in.data) {
+        memmove(c->in.data, p, c->in.len);
+    }
+    return rc;
+}
+
+static void buf_release(kv_buf_t *b) {
+    if (b->heap) {
+        free(b->data);
+    }
+}
+
+// 连接协程：读到 EAGAIN 为止处理所有流水线命令，挂起前一次性发送全部响应
+static void kv_conn_handler(void *arg) {
+    const kv_conn_start_t *start = (const kv_conn_start_t *)arg;
+    int fd = start->fd;
+    
+    kv_conn_t *c = (kv_conn_t *)co_alloc(sizeof(kv_conn_t));
+    char *in = (char *)co_alloc(KV_READ_BUFFER);
+    char *out = (char *)co_alloc(KV_WRITE_BUFFER);
+    if (c == NULL || in == NULL || out == NULL) {
+        perror("co_alloc kv_conn error");
+        goto out;
+    }
+    memset(c, 0, sizeof(*c));
+    c->fd = fd;
+    c->w = start->w;
+    c->in.data = in;
+    c->in.cap = KV_READ_BUFFER;
+    c->out.data = out;
+    c->out.cap = KV_WRITE_BUFFER;
+    
+    for (;;) {
+        // 保证至少有1字节空间，set 的大数据块按需一次扩到位
+        size_t want = c->need > c->in.len ? c->need - c->in.len : 1;
+        if (buf_reserve(&c->in, want) < 0) {
+            perror("kv_conn buffer error");
+            break;
+        }
+        
+        ssize_t n = recv(fd, c->in.data + c->in.len, c->in.cap - c->in.len, 0);
+        if (n > 0) {
+            c->in.len += n;
+            if (kv_process(c) < 0) {
+                break;
+            }
+            continue;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // 本轮请求已全部处理，合并发送后等待下一批
+            if (kv_flush(c) < 0) {
+                break;
+            }
+            if (reactor_wait(fd, EPOLLIN) < 0) {
+                // 等待失败时再 recv 只会反复得到 EAGAIN，空转不让出
+                perror("reactor_wait error");
+                break;
+            }
+            continue;
+        }
+        if (errno != EINTR) {
+            break;
+        }
+    }
+    
+    kv_flush(c);
+    buf_release(&c->in);
+    buf_release(&c->out);
+    
+out:
+    reactor_remove(fd);
+    close(fd);
+}
+
+// 接受连接的协程：每个工作线程一个，只接受自己的 SO_REUSEPORT 套接字上的连接
+static void kv_accept_handler(void *arg) {
+    kv_worker_t *w = (kv_worker_t *)arg;
+    
+    while (running) {
+        int fd = accept4(w->listen_fd, NULL, NULL, SOCK_NONBLOCK);
+        if (fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (reactor_wait(w->listen_fd, EPOLLIN) < 0) {
+                    perror("reactor_wait error");
+                    break;
+                }
+                continue;
+            } else if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            perror("accept error");
+            break;
+        }
+        
+        // 请求/响应协议，关闭 Nagle 避免响应被延迟
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        
+        kv_conn_start_t start = { fd, w };
+        coroutine_t *co = coroutine_create_arena(kv_conn_handler, &start,
+                                                 KV_CONN_STACK_SIZE, KV_CONN_ARENA_SIZE);
+        if (co == NULL) {
+            perror("coroutine_create error");
+            close(fd);
+            continue;
+        }
+        coroutine_detach(co);
+        
+        if (reactor_add(fd) < 0) {
+            coroutine_destroy(co);
+            close(fd);
+            continue;
+        }
+        
+        w->conns++;
+        
+        // start 在连接协程第一次挂起之前保持有效
+        coroutine_resume(co);
+    }
+}
+
+// 工作线程：私有的 reactor 和协程运行时
+static void *kv_worker_main(void *arg) {
+    kv_worker_t *w = (kv_worker_t *)arg;
+    
+    if (reactor_init() < 0) {
+        return NULL;
+    }
+    if (reactor_add(w->listen_fd) < 0) {
+        reactor_destroy();
+        return NULL;
+    }
+    
+    coroutine_t *co = coroutine_create(kv_accept_handler, w, 64 * 1024);
+    if (co == NULL) {
+        perror("coroutine_create kv_accept_handler error");
+        reactor_destroy();
+        coroutine_thread_exit();
+        return NULL;
+    }
+    coroutine_handle_t accept_co = coroutine_handle(co);
+    coroutine_resume(co);
+    
+    reactor_run(&running);
+    
+    coroutine_destroy(coroutine_lookup(accept_co));
+    reactor_remove(w->listen_fd);
+    reactor_destroy();
+    coroutine_thread_exit();
+    return NULL;
+}
+
+// 信号处理函数
+static void signal_handler(int sig) {
+    if (sig == SIGINT || sig == SIGTERM) {
+        printf("\n收到停止信号，正在关闭服务器...\n");
+        running = 0;
+    }
+}
+
+static void kv_print_stats(kv_worker_t *workers, int nthreads, kv_store_t *store) {
+    uint64_t commands = 0, hits = 0, misses = 0, sets = 0, flushes = 0;
+    
+    for (int i = 0; i < nthreads; i++) {
+        kv_worker_t *w = &workers[i];
+        printf("  线程 %d: 连接 %llu 个，命令 %llu 条\n", w->id,
+               (unsigned long long)w->conns, (unsigned long long)w->commands);
+        commands += w->commands;
+        hits += w->get_hits;
+        misses += w->get_misses;
+        sets += w->sets;
+        flushes += w->flushes;
+    }
+    
+    printf("命令 %llu 条（set %llu），get 命中 %llu / 未命中 %llu",
+           (unsigned long long)commands, (unsigned long long)sets,
+           (unsigned long long)hits, (unsigned long long)misses);
+    if (flushes > 0) {
+        printf("，平均每次发送合并 %.1f 条命令的响应", (double)commands / flushes);
+    }
+    printf("\n");
+    
+    kv_stats_t st;
+    kv_store_stats(store, &st);
+    printf("存储: %llu 个条目，slab 页 %zu / %zu KiB，淘汰 %llu 个，过期回收 %llu 个\n",
+           (unsigned long long)st.items, st.mem_used / 1024, st.mem_limit / 1024,
+           (unsigned long long)st.evictions, (unsigned long long)st.expired);
+}
+
+int kv_server_start(const kv_server_options_t *opts) {
+    // 每个分片至少一页（1 MiB）
+    if (opts->threads <= 0 || opts->threads > KV_MAX_THREADS ||
+        opts->memory_mb < (size_t)opts->threads) {
+        fprintf(stderr, "无效的选项: threads=%d memory=%zu MiB\n", opts->threads, opts->memory_mb);
+        return -1;
+    }
+    
+    // 每个工作线程一个分片，分片内存上限之和为 memory_mb
+    kv_store_t *store = kv_store_create(opts->threads, opts->memory_mb * 1024 * 1024);
+    if (store == NULL) {
+        perror("kv_store_create error");
+        return -1;
+    }
+    
+    kv_worker_t *workers = (kv_worker_t *)aligned_alloc(64, sizeof(kv_worker_t) * opts->threads);
+    if (workers == NULL) {
+        perror("malloc workers error");
+        kv_store_destroy(store);
+        return -1;
+    }
+    memset(workers, 0, sizeof(kv_worker_t) * opts->threads);
+    
+    // 在主线程创建所有监听套接字，端口被占用等错误在启动时立即报告
+    int nstarted = 0;
+    for (int i = 0; i < opts->threads; i++) {
+        workers[i].id = i;
+        workers[i].store = store;
+        workers[i].listen_fd = net_listen_tcp(opts->port, KV_BACKLOG, 1);
+        if (workers[i].listen_fd < 0) {
+            for (int j = 0; j < i; j++) {
+                close(workers[j].listen_fd);
+            }
+            free(workers);
+            kv_store_destroy(store);
+            return -1;
+        }
+    }
+    
+    // 工作线程屏蔽信号，由主线程处理停止请求
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (int i = 0; i < opts->threads; i++) {
+        if (pthread_create(&workers[i].thread, NULL, kv_worker_main, &workers[i]) != 0) {
+            perror("pthread_create error");
+            running = 0;
+            break;
+        }
+        nstarted++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+    
+    printf("=== KV Server 启动 ===\n");
+    printf("监听端口: %d，工作线程: %d，内存上限: %zu MiB\n",
+           opts->port, opts->threads, opts->memory_mb);
+    printf("按 Ctrl+C 停止服务器\n\n");
+    
+    // 工作线程在 running 清零后的一个轮询周期内退出
+    for (int i = 0; i < nstarted; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    
+    kv_print_stats(workers, opts->threads, store);
+    
+    for (int i = 0; i < opts->threads; i++) {
+        close(workers[i].listen_fd);
+    }
+    free(workers);
+    kv_store_destroy(store);
+    
+    printf("服务器已关闭\n");
+    return nstarted == opts->threads ? 0 : -1;
+}
@@ -0,0 +1,54 @@
+#ifndef KV_SERVER_H
+#define KV_SERVER_H
+
+#include "kv_store.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// 服务器配置
+#define KV_DEFAULT_PORT 11211
+#define KV_DEFAULT_MEMORY_MB 64
+#define KV_MAX_THREADS 64
+#define KV_BACKLOG 1024
+#define KV_CONN_STACK_SIZE (64 * 1024)   // 连接协程栈大小
+#define KV_CONN_ARENA_SIZE (40 * 1024)   // 连接协程 arena（容纳连接结构和初始缓冲区）
+#define KV_READ_BUFFER 16384             // 初始接收缓冲区
+#define KV_WRITE_BUFFER 16384            // 初始发送缓冲区
+#define KV_MAX_LINE 2048                 // 命令行最大长度（不含数据块）
+#define KV_MAX_TOKENS 24                 // 单条命令的最大参数数（get 的键不受此限制）
+#define KV_FLUSH_THRESHOLD (256 * 1024)  // 发送缓冲区超过该值时立即发送，不等本轮读完
+#define KV_VERSION "1.0.0-coroutine"
+
+// 服务器选项
+typedef struct kv_server_options {
+    int port;                    // 监听端口
+    int threads;                 // 工作线程数，每个线程一个 reactor 和一个 SO_REUSEPORT 套接字
+    size_t memory_mb;            // 存储内存上限（MiB）
+} kv_server_options_t;
+
+// 工作线程：私有的 reactor、监听套接字和统计，共享存储
+typedef struct kv_worker {
+    _Alignas(64)
+    int id;
+    int listen_fd;
+    kv_store_t *store;
+    pthread_t thread;
+    
+    // 统计（只由本线程写）
+    uint64_t conns;              // 接受的连接数
+    uint64_t commands;           // 处理的命令数
+    uint64_t get_hits;           // get 命中的键数
+    uint64_t get_misses;         // get 未命中的键数
+    uint64_t sets;               // set 命令数
+    uint64_t flushes;            // 批量发送次数（每次一个 net_send_all）
+} kv_worker_t;
+
+/**
+ * 启动 memcached 文本协议兼容的键值服务器，阻塞直到收到停止信号
+ * @param opts 服务器选项
+ * @return 0 成功，-1 失败
+ */
+int kv_server_start(const kv_server_options_t *opts);
+
+#endif // KV_SERVER_H
@@ -0,0 +1,53 @@
+#define _GNU_SOURCE
+#include "kv_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void usage(const char *prog) {
+    fprintf(stderr, "使用方法: %s [-t 线程数] [-m 内存MiB] [端口号]\n", prog);
+    fprintf(stderr, "  -t  工作线程数（默认 CPU 数，最多 %d）\n", KV_MAX_THREADS);
+    fprintf(stderr, "  -m  存储内存上限（默认 %d MiB）\n", KV_DEFAULT_MEMORY_MB);
+}
+
+int main(int argc, char *argv[]) {
+    kv_server_options_t opts = { KV_DEFAULT_PORT, 1, KV_DEFAULT_MEMORY_MB };
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+    
+    if (ncpu > 0) {
+        opts.threads = ncpu < KV_MAX_THREADS ? (int)ncpu : KV_MAX_THREADS;
+    }
+    
+    while ((opt = getopt(argc, argv, "t:m:")) != -1) {
+        switch (opt) {
+        case 't':
+            opts.threads = atoi(optarg);
+            break;
+        case 'm':
+            opts.memory_mb = (size_t)atol(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (optind < argc) {
+        opts.port = atoi(argv[optind]);
+        if (opts.port <= 0 || opts.port > 65535) {
+            fprintf(stderr, "无效的端口号: %s\n", argv[optind]);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    printf("启动 KV Server，端口: %d\n", opts.port);
+    
+    if (kv_server_start(&opts) < 0) {
+        fprintf(stderr, "启动服务器失败\n");
+        return 1;
+    }
+    
+    return 0;
+}
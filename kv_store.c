@@ -0,0 +1,507 @@
+#include "kv_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define KV_ITEM_HEADER sizeof(kv_item_t)
+
+// 哈希表装载因子上限（count / cap）
+#define KV_TABLE_LOAD_NUM 7
+#define KV_TABLE_LOAD_DEN 10
+
+// FNV-1a 64 位哈希
+static uint64_t kv_hash(const char *key, size_t nkey) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < nkey; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 1099511628211ULL;
+    }
+    // 低位用于哈希表下标，高位用于选择分片，混合一下避免相关
+    h ^= h >> 29;
+    return h;
+}
+
+static uint32_t kv_now(void) {
+    return (uint32_t)time(NULL);
+}
+
+static inline char *item_key(kv_item_t *it) {
+    return it->data;
+}
+
+static inline char *item_value(kv_item_t *it) {
+    return it->data + it->nkey;
+}
+
+static inline int item_expired(const kv_item_t *it, uint32_t now) {
+    return it->exptime != 0 && it->exptime <= now;
+}
+
+static inline kv_shard_t *shard_for(kv_store_t *st, uint64_t hash) {
+    return &st->shards[(hash >> 48) % (uint64_t)st->nshards];
+}
+
+// ---------------------------------------------------------------------------
+// 哈希表：开放寻址 + 线性探测，删除时向后移位（无墓碑）
+// ---------------------------------------------------------------------------
+
+static size_t table_find(kv_shard_t *sh, uint64_t hash, const char *key, size_t nkey) {
+    size_t mask = sh->table_cap - 1;
+    size_t i = hash & mask;
+    
+    while (sh->table[i].item != NULL) {
+        kv_item_t *it = sh->table[i].item;
+        if (sh->table[i].hash == hash && it->nkey == nkey &&
+            memcmp(item_key(it), key, nkey) == 0) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return SIZE_MAX;
+}
+
+static void table_put(kv_entry_t *table, size_t cap, uint64_t hash, kv_item_t *it) {
+    size_t mask = cap - 1;
+    size_t i = hash & mask;
+    while (table[i].item != NULL) {
+        i = (i + 1) & mask;
+    }
+    table[i].hash = hash;
+    table[i].item = it;
+}
+
+static int table_grow(kv_shard_t *sh) {
+    size_t new_cap = sh->table_cap * 2;
+    kv_entry_t *t = (kv_entry_t *)calloc(new_cap, sizeof(kv_entry_t));
+    if (t == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < sh->table_cap; i++) {
+        if (sh->table[i].item != NULL) {
+            table_put(t, new_cap, sh->table[i].hash, sh->table[i].item);
+        }
+    }
+    free(sh->table);
+    sh->table = t;
+    sh->table_cap = new_cap;
+    return 0;
+}
+
+static int table_insert(kv_shard_t *sh, uint64_t hash, kv_item_t *it) {
+    if ((sh->count + 1) * KV_TABLE_LOAD_DEN > sh->table_cap * KV_TABLE_LOAD_NUM &&
+        table_grow(sh) < 0) {
+        return -1;
+    }
+    table_put(sh->table, sh->table_cap, hash, it);
+    sh->count++;
+    return 0;
+}
+
+static void table_remove_at(kv_shard_t *sh, size_t i) {
+    size_t mask = sh->table_cap - 1;
+    sh->table[i].item = NULL;
+    sh->count--;
+    
+    // 把后面探测链上的条目前移，保证查找不会因空槽提前终止
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (sh->table[j].item == NULL) {
+            break;
+        }
+        size_t home = sh->table[j].hash & mask;
+        // home 在循环区间 (i, j] 内时条目可以留在原地
+        int stays = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (!stays) {
+            sh->table[i] = sh->table[j];
+            sh->table[j].item = NULL;
+            i = j;
+        }
+    }
+}
+
+// 按条目指针删除（淘汰时使用）
+static void table_remove_item(kv_shard_t *sh, kv_item_t *it) {
+    size_t mask = sh->table_cap - 1;
+    size_t i = it->hash & mask;
+    while (sh->table[i].item != NULL) {
+        if (sh->table[i].item == it) {
+            table_remove_at(sh, i);
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// slab 分配与 CLOCK 淘汰
+// ---------------------------------------------------------------------------
+
+static int class_for(kv_store_t *st, size_t total) {
+    for (int i = 0; i < st->nclasses; i++) {
+        if (st->class_sizes[i] >= total) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static inline kv_item_t **free_next(kv_item_t *it) {
+    return (kv_item_t **)it->data;
+}
+
+static void item_free(kv_shard_t *sh, kv_item_t *it) {
+    kv_slab_class_t *c = &sh->classes[it->clsid];
+    it->iflags = 0;
+    *free_next(it) = c->free_list;
+    c->free_list = it;
+}
+
+static int class_add_page(kv_shard_t *sh, kv_slab_class_t *c, int clsid) {
+    if (c->npages == c->cap_pages) {
+        uint32_t cap = c->cap_pages ? c->cap_pages * 2 : 8;
+        char **pages = (char **)realloc(c->pages, cap * sizeof(char *));
+        if (pages == NULL) {
+            return -1;
+        }
+        c->pages = pages;
+        c->cap_pages = cap;
+    }
+    
+    char *page = (char *)malloc(KV_PAGE_SIZE);
+    if (page == NULL) {
+        return -1;
+    }
+    c->pages[c->npages++] = page;
+    sh->mem_used += KV_PAGE_SIZE;
+    
+    // 把整页切成块放入空闲链表
+    for (uint32_t i = 0; i < c->per_page; i++) {
+        kv_item_t *it = (kv_item_t *)(page + (size_t)i * c->chunk_size);
+        it->clsid = (uint8_t)clsid;
+        item_free(sh, it);
+    }
+    return 0;
+}
+
+// 沿 CLOCK 指针扫描本类的块：过期的直接回收，最近访问过的清除标志放过一次，
+// 否则淘汰。最多扫描两圈
+static kv_item_t *class_evict(kv_shard_t *sh, kv_slab_class_t *c, uint32_t now) {
+    uint64_t total = (uint64_t)c->npages * c->per_page;
+    
+    for (uint64_t n = 0; n < total * 2; n++) {
+        uint64_t slot = c->hand++ % total;
+        kv_item_t *it = (kv_item_t *)(c->pages[slot / c->per_page] +
+                                      (size_t)(slot % c->per_page) * c->chunk_size);
+        if (!(it->iflags & KV_ITEM_USED)) {
+            continue;
+        }
+        if ((it->iflags & KV_ITEM_REF) && !item_expired(it, now)) {
+            it->iflags &= ~KV_ITEM_REF;
+            continue;
+        }
+        
+        if (item_expired(it, now)) {
+            sh->expired++;
+        } else {
+            sh->evictions++;
+        }
+        table_remove_item(sh, it);
+        it->iflags = 0;
+        return it;
+    }
+    return NULL;
+}
+
+static kv_item_t *item_alloc(kv_store_t *st, kv_shard_t *sh, size_t nkey, size_t nbytes,
+                             uint32_t now, kv_status_t *status) {
+    size_t total = KV_ITEM_HEADER + nkey + nbytes;
+    int clsid = class_for(st, total);
+    if (clsid < 0) {
+        *status = KV_TOO_LARGE;
+        return NULL;
+    }
+    
+    kv_slab_class_t *c = &sh->classes[clsid];
+    kv_item_t *it = c->free_list;
+    
+    if (it == NULL) {
+        // 未达到内存上限时分配新页。上限是硬性的：内存已被其他类占满时，
+        // 还没有页的类无法存储（返回 KV_NO_MEMORY），与不做 slab 迁移的 memcached 一致
+        if (sh->mem_used + KV_PAGE_SIZE <= sh->mem_limit) {
+            if (class_add_page(sh, c, clsid) == 0) {
+                it = c->free_list;
+            }
+        }
+    }
+    
+    if (it != NULL) {
+        c->free_list = *free_next(it);
+    } else if (c->npages > 0) {
+        it = class_evict(sh, c, now);
+    }
+    
+    if (it == NULL) {
+        *status = KV_NO_MEMORY;
+        return NULL;
+    }
+    
+    it->clsid = (uint8_t)clsid;
+    it->iflags = KV_ITEM_USED;
+    it->nkey = (uint16_t)nkey;
+    it->nbytes = (uint32_t)nbytes;
+    return it;
+}
+
+// ---------------------------------------------------------------------------
+// 公共接口
+// ---------------------------------------------------------------------------
+
+kv_store_t *kv_store_create(int nshards, size_t mem_limit) {
+    // 每个分片至少要能放下一页，否则什么都存不了
+    if (nshards <= 0 || mem_limit / nshards < KV_PAGE_SIZE) {
+        return NULL;
+    }
+    
+    kv_store_t *st = (kv_store_t *)calloc(1, sizeof(kv_store_t));
+    if (st == NULL) {
+        return NULL;
+    }
+    
+    // 块大小按 KV_CHUNK_GROWTH 递增（8字节对齐），最后一类为整页
+    double size = KV_MIN_CHUNK;
+    while (st->nclasses < KV_MAX_CLASSES - 1 && size < KV_PAGE_SIZE / 2) {
+        st->class_sizes[st->nclasses++] = ((uint32_t)size + 7) & ~7u;
+        size *= KV_CHUNK_GROWTH;
+    }
+    st->class_sizes[st->nclasses++] = KV_PAGE_SIZE;
+    
+    st->nshards = nshards;
+    st->shards = (kv_shard_t *)aligned_alloc(64, sizeof(kv_shard_t) * nshards);
+    if (st->shards == NULL) {
+        free(st);
+        return NULL;
+    }
+    memset(st->shards, 0, sizeof(kv_shard_t) * nshards);
+    
+    for (int i = 0; i < nshards; i++) {
+        kv_shard_t *sh = &st->shards[i];
+        pthread_mutex_init(&sh->lock, NULL);
+        sh->mem_limit = mem_limit / nshards;
+        sh->table_cap = KV_TABLE_INITIAL;
+        sh->table = (kv_entry_t *)calloc(sh->table_cap, sizeof(kv_entry_t));
+        if (sh->table == NULL) {
+            kv_store_destroy(st);
+            return NULL;
+        }
+        for (int c = 0; c < st->nclasses; c++) {
+            sh->classes[c].chunk_size = st->class_sizes[c];
+            sh->classes[c].per_page = KV_PAGE_SIZE / st->class_sizes[c];
+        }
+    }
+    return st;
+}
+
+void kv_store_destroy(kv_store_t *st) {
+    if (st == NULL) {
+        return;
+    }
+    for (int i = 0; i < st->nshards; i++) {
+        kv_shard_t *sh = &st->shards[i];
+        for (int c = 0; c < st->nclasses; c++) {
+            for (uint32_t p = 0; p < sh->classes[c].npages; p++) {
+                free(sh->classes[c].pages[p]);
+            }
+            free(sh->classes[c].pages);
+        }
+        free(sh->table);
+        pthread_mutex_destroy(&sh->lock);
+    }
+    free(st->shards);
+    free(st);
+}
+
+// 查找未过期的条目，返回哈希表下标（不存在返回 SIZE_MAX），过期的顺便回收；调用者持有分片锁
+static size_t shard_find(kv_shard_t *sh, uint64_t hash, const char *key, size_t nkey,
+                         uint32_t now) {
+    size_t i = table_find(sh, hash, key, nkey);
+    if (i == SIZE_MAX) {
+        return SIZE_MAX;
+    }
+    kv_item_t *it = sh->table[i].item;
+    if (item_expired(it, now)) {
+        table_remove_at(sh, i);
+        item_free(sh, it);
+        sh->expired++;
+        return SIZE_MAX;
+    }
+    return i;
+}
+
+static kv_item_t *shard_lookup(kv_shard_t *sh, uint64_t hash, const char *key, size_t nkey,
+                               uint32_t now) {
+    size_t i = shard_find(sh, hash, key, nkey, now);
+    return i == SIZE_MAX ? NULL : sh->table[i].item;
+}
+
+kv_status_t kv_get(kv_store_t *st, const char *key, size_t nkey, kv_value_fn fn, void *ctx) {
+    uint64_t hash = kv_hash(key, nkey);
+    kv_shard_t *sh = shard_for(st, hash);
+    kv_status_t status = KV_NOT_FOUND;
+    
+    pthread_mutex_lock(&sh->lock);
+    kv_item_t *it = shard_lookup(sh, hash, key, nkey, kv_now());
+    if (it != NULL) {
+        it->iflags |= KV_ITEM_REF;
+        fn(ctx, item_key(it), it->nkey, it->flags, item_value(it), it->nbytes);
+        status = KV_OK;
+    }
+    pthread_mutex_unlock(&sh->lock);
+    return status;
+}
+
+// 写入已定位分片的条目；调用者持有分片锁
+static kv_status_t shard_store(kv_store_t *st, kv_shard_t *sh, uint64_t hash,
+                               const char *key, size_t nkey, uint32_t flags, uint32_t exptime,
+                               const char *data, size_t nbytes, uint32_t now) {
+    kv_status_t status = KV_OK;
+    
+    // 先分配（可能淘汰其他条目并改动哈希表），再查找旧值
+    kv_item_t *it = item_alloc(st, sh, nkey, nbytes, now, &status);
+    if (it == NULL) {
+        return status;
+    }
+    
+    it->hash = hash;
+    it->flags = flags;
+    it->exptime = exptime;
+    memcpy(item_key(it), key, nkey);
+    memcpy(item_value(it), data, nbytes);
+    
+    size_t i = table_find(sh, hash, key, nkey);
+    if (i != SIZE_MAX) {
+        item_free(sh, sh->table[i].item);
+        sh->table[i].item = it;
+        return KV_OK;
+    }
+    
+    if (table_insert(sh, hash, it) < 0) {
+        item_free(sh, it);
+        return KV_NO_MEMORY;
+    }
+    return KV_OK;
+}
+
+kv_status_t kv_set(kv_store_t *st, const char *key, size_t nkey, uint32_t flags,
+                   int64_t exptime, const char *data, size_t nbytes) {
+    uint64_t hash = kv_hash(key, nkey);
+    kv_shard_t *sh = shard_for(st, hash);
+    uint32_t now = kv_now();
+    kv_status_t status;
+    
+    pthread_mutex_lock(&sh->lock);
+    if (exptime < 0) {
+        // 立即过期：等价于删除旧值
+        size_t i = table_find(sh, hash, key, nkey);
+        if (i != SIZE_MAX) {
+            kv_item_t *old = sh->table[i].item;
+            table_remove_at(sh, i);
+            item_free(sh, old);
+        }
+        status = KV_OK;
+    } else {
+        uint32_t abs = 0;
+        if (exptime > 0) {
+            abs = exptime <= KV_RELATIVE_TTL_MAX ? now + (uint32_t)exptime : (uint32_t)exptime;
+        }
+        status = shard_store(st, sh, hash, key, nkey, flags, abs, data, nbytes, now);
+    }
+    pthread_mutex_unlock(&sh->lock);
+    return status;
+}
+
+kv_status_t kv_delete(kv_store_t *st, const char *key, size_t nkey) {
+    uint64_t hash = kv_hash(key, nkey);
+    kv_shard_t *sh = shard_for(st, hash);
+    kv_status_t status = KV_NOT_FOUND;
+    
+    pthread_mutex_lock(&sh->lock);
+    size_t i = shard_find(sh, hash, key, nkey, kv_now());
+    if (i != SIZE_MAX) {
+        kv_item_t *it = sh->table[i].item;
+        table_remove_at(sh, i);
+        item_free(sh, it);
+        status = KV_OK;
+    }
+    pthread_mutex_unlock(&sh->lock);
+    return status;
+}
+
+kv_status_t kv_incr(kv_store_t *st, const char *key, size_t nkey, uint64_t delta,
+                    int decr, uint64_t *result) {
+    uint64_t hash = kv_hash(key, nkey);
+    kv_shard_t *sh = shard_for(st, hash);
+    uint32_t now = kv_now();
+    kv_status_t status = KV_OK;
+    
+    pthread_mutex_lock(&sh->lock);
+    kv_item_t *it = shard_lookup(sh, hash, key, nkey, now);
+    if (it == NULL) {
+        status = KV_NOT_FOUND;
+        goto out;
+    }
+    
+    // 解析十进制值（最多20位）
+    const char *v = item_value(it);
+    uint64_t value = 0;
+    if (it->nbytes == 0 || it->nbytes > 20) {
+        status = KV_NOT_NUMBER;
+        goto out;
+    }
+    for (uint32_t i = 0; i < it->nbytes; i++) {
+        if (v[i] < '0' || v[i] > '9' || value > (UINT64_MAX - (v[i] - '0')) / 10) {
+            status = KV_NOT_NUMBER;
+            goto out;
+        }
+        value = value * 10 + (v[i] - '0');
+    }
+    
+    if (decr) {
+        value = value > delta ? value - delta : 0;
+    } else {
+        value += delta;  // 64位回绕，与 memcached 一致
+    }
+    *result = value;
+    
+    char digits[24];
+    int len = snprintf(digits, sizeof(digits), "%llu", (unsigned long long)value);
+    
+    // 新值放得下就原地更新，否则重新写入
+    size_t room = sh->classes[it->clsid].chunk_size - KV_ITEM_HEADER - it->nkey;
+    if ((size_t)len <= room) {
+        memcpy(item_value(it), digits, len);
+        it->nbytes = (uint32_t)len;
+        it->iflags |= KV_ITEM_REF;
+    } else {
+        status = shard_store(st, sh, hash, key, nkey, it->flags, it->exptime, digits, len, now);
+    }
+    
+out:
+    pthread_mutex_unlock(&sh->lock);
+    return status;
+}
+
+void kv_store_stats(kv_store_t *st, kv_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    for (int i = 0; i < st->nshards; i++) {
+        kv_shard_t *sh = &st->shards[i];
+        pthread_mutex_lock(&sh->lock);
+        out->items += sh->count;
+        out->evictions += sh->evictions;
+        out->expired += sh->expired;
+        out->mem_used += sh->mem_used;
+        out->mem_limit += sh->mem_limit;
+        pthread_mutex_unlock(&sh->lock);
+    }
+}
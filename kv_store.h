@@ -0,0 +1,144 @@
+#ifndef KV_STORE_H
+#define KV_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// 存储配置
+#define KV_MAX_KEY_LEN 250                       // memcached 协议的键长上限
+#define KV_PAGE_SIZE (1024 * 1024)               // slab 页大小，也是单个条目的上限
+#define KV_MIN_CHUNK 64                          // 最小 slab 块
+#define KV_CHUNK_GROWTH 1.25                     // 相邻 slab 类的块大小比例
+#define KV_MAX_CLASSES 64
+#define KV_TABLE_INITIAL 1024                    // 每个分片哈希表的初始容量（2的幂）
+#define KV_RELATIVE_TTL_MAX (60 * 60 * 24 * 30)  // 不超过30天的过期时间视为相对秒数
+
+// 条目标志
+#define KV_ITEM_USED 0x1  // 块已被条目占用
+#define KV_ITEM_REF  0x2  // 最近被访问过（CLOCK 淘汰时给一次机会）
+
+// 操作结果
+typedef enum {
+    KV_OK,
+    KV_NOT_FOUND,
+    KV_NOT_NUMBER,  // incr/decr 的值不是十进制数
+    KV_NO_MEMORY,   // 无法分配（也无可淘汰的条目）
+    KV_TOO_LARGE    // 条目超过 KV_PAGE_SIZE
+} kv_status_t;
+
+// 条目：头部后紧跟键和值，存放在 slab 块中
+typedef struct kv_item {
+    uint64_t hash;     // 键的哈希值
+    uint32_t exptime;  // 过期时间（unix 秒），0 表示永不过期
+    uint32_t flags;    // 客户端 flags
+    uint32_t nbytes;   // 值长度
+    uint16_t nkey;     // 键长度
+    uint8_t clsid;     // 所属 slab 类
+    uint8_t iflags;    // KV_ITEM_USED / KV_ITEM_REF
+    char data[];       // 键 + 值
+} kv_item_t;
+
+// slab 类：相同大小的块，按页分配，空闲块串成链表
+typedef struct kv_slab_class {
+    uint32_t chunk_size;   // 块大小
+    uint32_t per_page;     // 每页块数
+    char **pages;          // 已分配的页
+    uint32_t npages;
+    uint32_t cap_pages;
+    kv_item_t *free_list;  // 空闲块（下一个指针存放在 data 中）
+    uint64_t hand;         // CLOCK 指针（全类统一编号的块序号）
+} kv_slab_class_t;
+
+// 哈希表槽位（开放寻址，线性探测）
+typedef struct kv_entry {
+    uint64_t hash;
+    kv_item_t *item;       // NULL 表示空槽
+} kv_entry_t;
+
+// 分片：独立的锁、哈希表、slab 类和内存上限
+typedef struct kv_shard {
+    _Alignas(64)
+    pthread_mutex_t lock;
+    kv_entry_t *table;
+    size_t table_cap;
+    size_t count;
+    kv_slab_class_t classes[KV_MAX_CLASSES];
+    size_t mem_used;       // 已分配的 slab 页字节数
+    size_t mem_limit;
+    uint64_t evictions;    // CLOCK 淘汰的条目数
+    uint64_t expired;      // 因过期回收的条目数
+} kv_shard_t;
+
+// 存储：按键的哈希分成多个分片
+typedef struct kv_store {
+    kv_shard_t *shards;
+    int nshards;
+    uint32_t class_sizes[KV_MAX_CLASSES];
+    int nclasses;
+} kv_store_t;
+
+// 统计
+typedef struct kv_stats {
+    uint64_t items;
+    uint64_t evictions;
+    uint64_t expired;
+    size_t mem_used;
+    size_t mem_limit;
+} kv_stats_t;
+
+/**
+ * get 命中时的回调，在分片锁内调用，数据只在回调期间有效
+ */
+typedef void (*kv_value_fn)(void *ctx, const char *key, size_t nkey,
+                            uint32_t flags, const char *data, size_t nbytes);
+
+/**
+ * 创建存储
+ * @param nshards 分片数（通常等于工作线程数）
+ * @param mem_limit 总内存上限（字节），平均分给各分片，slab 页总量不会超过它；
+ *                  每个分片至少 KV_PAGE_SIZE
+ * @return 存储指针，失败返回NULL
+ */
+kv_store_t *kv_store_create(int nshards, size_t mem_limit);
+
+/**
+ * 销毁存储，释放所有页
+ */
+void kv_store_destroy(kv_store_t *st);
+
+/**
+ * 查找键，命中时调用 fn
+ * @return KV_OK 或 KV_NOT_FOUND
+ */
+kv_status_t kv_get(kv_store_t *st, const char *key, size_t nkey, kv_value_fn fn, void *ctx);
+
+/**
+ * 写入键（覆盖已有值）
+ * @param exptime memcached 语义：0 永不过期，负数立即过期，
+ *                不超过30天为相对秒数，否则为 unix 时间戳
+ * @return KV_OK、KV_NO_MEMORY 或 KV_TOO_LARGE
+ */
+kv_status_t kv_set(kv_store_t *st, const char *key, size_t nkey, uint32_t flags,
+                   int64_t exptime, const char *data, size_t nbytes);
+
+/**
+ * 删除键
+ * @return KV_OK 或 KV_NOT_FOUND
+ */
+kv_status_t kv_delete(kv_store_t *st, const char *key, size_t nkey);
+
+/**
+ * 对十进制值加/减 delta（加法按64位回绕，减法最小为0）
+ * @param result 新值
+ * @return KV_OK、KV_NOT_FOUND、KV_NOT_NUMBER 或 KV_NO_MEMORY
+ */
+kv_status_t kv_incr(kv_store_t *st, const char *key, size_t nkey, uint64_t delta,
+                    int decr, uint64_t *result);
+
+/**
+ * 汇总所有分片的统计
+ */
+void kv_store_stats(kv_store_t *st, kv_stats_t *out);
+
+#endif // KV_STORE_H
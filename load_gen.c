@@ -0,0 +1,1166 @@
+// 负载生成器：对各个服务器目标施压并报告吞吐量
+// 使用方法: load_gen <模式> [选项]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <strings.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#define DEFAULT_HOST "127.0.0.1"
+#define DEFAULT_PORT 8888
+#define DEFAULT_SECONDS 5
+#define UDP_MAX_BATCH 1024
+#define UDP_GSO_MAX_SEGMENTS 64      // 单次 UDP_SEGMENT 发送的最大段数
+#define UDP_GSO_MAX_BYTES 65000      // 单次 UDP_SEGMENT 发送的最大字节数
+#define UDP_REPLY_TIMEOUT_MS 20      // 等待回显的超时，超时未到的数据报计为丢失
+#define UDP_RECV_SLOT 2048
+#define ONESHOT_TIMEOUT_SECS 5       // 短连接模式下单个连接的收发超时
+#define KV_DEFAULT_KEYS 10000        // kv 模式的键空间大小
+#define KV_DEFAULT_SET_PERCENT 10    // kv 模式中 set 请求的百分比
+#define KV_POPULATE_BATCH 1000       // 预填充时每批 set 数
+#define KV_RECV_BUFFER (1024 * 1024)
+#define HTTP_RECV_BUFFER 16384       // http 模式每个连接的接收缓冲区
+#define HTTP_MAX_BATCH 64            // http 模式的最大流水线深度
+#define STREAM_RECV_BUFFER (256 * 1024)
+#define STREAM_WINDOW_CHUNKS 8       // stream 模式每个连接最多未回显的块数
+
+// 通用选项
+typedef struct load_options {
+    const char *host;
+    int port;
+    int conns;       // 连接/套接字数量
+    int batch;       // 每轮每个套接字发送的请求数
+    int size;        // 负载大小（字节）
+    int seconds;     // 持续时间
+    int gso;         // UDP：使用 UDP_SEGMENT 发送
+    int keys;        // kv：键空间大小
+    int set_percent; // kv：set 请求的百分比
+} load_options_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int make_addr(const load_options_t *o, struct sockaddr_in *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(o->port);
+    if (inet_pton(AF_INET, o->host, &addr->sin_addr) <= 0) {
+        fprintf(stderr, "无效的地址: %s\n", o->host);
+        return -1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// 延迟统计：收集每个请求的耗时（微秒），结束后排序求分位数
+// ---------------------------------------------------------------------------
+
+typedef struct latency_log {
+    double *us;
+    size_t count;
+    size_t cap;
+} latency_log_t;
+
+static void latency_add(latency_log_t *log, double us) {
+    if (log->count == log->cap) {
+        size_t cap = log->cap ? log->cap * 2 : 4096;
+        double *p = (double *)realloc(log->us, cap * sizeof(double));
+        if (p == NULL) {
+            return;
+        }
+        log->us = p;
+        log->cap = cap;
+    }
+    log->us[log->count++] = us;
+}
+
+static void latency_merge(latency_log_t *dst, const latency_log_t *src) {
+    for (size_t i = 0; i < src->count; i++) {
+        latency_add(dst, src->us[i]);
+    }
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void latency_report(latency_log_t *log) {
+    if (log->count == 0) {
+        return;
+    }
+    qsort(log->us, log->count, sizeof(double), cmp_double);
+    double sum = 0;
+    for (size_t i = 0; i < log->count; i++) {
+        sum += log->us[i];
+    }
+    printf("延迟(us): 平均 %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  最大 %.1f\n",
+           sum / log->count,
+           log->us[log->count * 50 / 100], log->us[log->count * 90 / 100],
+           log->us[log->count * 99 / 100], log->us[log->count * 999 / 1000],
+           log->us[log->count - 1]);
+}
+
+// ---------------------------------------------------------------------------
+// oneshot 模式：每个工作线程循环执行 连接 → 发送请求 → 半关闭 → 读到 EOF → 关闭
+// 模拟短连接请求/响应，测量每秒完成的连接数
+// ---------------------------------------------------------------------------
+
+typedef struct oneshot_worker {
+    const load_options_t *o;
+    struct sockaddr_in addr;
+    double deadline;
+    uint64_t completed;
+    uint64_t failed;
+    latency_log_t lat;
+    pthread_t tid;
+} oneshot_worker_t;
+
+static int oneshot_once(oneshot_worker_t *w, const char *payload, char *buf) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    // 服务器无响应时不要无限阻塞
+    struct timeval tv = { ONESHOT_TIMEOUT_SECS, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (connect(fd, (struct sockaddr *)&w->addr, sizeof(w->addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (send(fd, payload, w->o->size, MSG_NOSIGNAL) != w->o->size) {
+        close(fd);
+        return -1;
+    }
+    shutdown(fd, SHUT_WR);
+    
+    ssize_t total = 0, n;
+    while ((n = recv(fd, buf, w->o->size, 0)) > 0) {
+        total += n;
+    }
+    close(fd);
+    return total == w->o->size ? 0 : -1;
+}
+
+static void *oneshot_thread(void *arg) {
+    oneshot_worker_t *w = (oneshot_worker_t *)arg;
+    char *payload = (char *)malloc(w->o->size);
+    char *buf = (char *)malloc(w->o->size);
+    memset(payload, 'x', w->o->size);
+    
+    while (now_sec() < w->deadline) {
+        double t0 = now_sec();
+        if (oneshot_once(w, payload, buf) == 0) {
+            w->completed++;
+            latency_add(&w->lat, (now_sec() - t0) * 1e6);
+        } else {
+            w->failed++;
+        }
+    }
+    
+    free(payload);
+    free(buf);
+    return NULL;
+}
+
+static int run_oneshot(const load_options_t *o) {
+    oneshot_worker_t *ws = (oneshot_worker_t *)calloc(o->conns, sizeof(*ws));
+    if (ws == NULL) {
+        perror("malloc error");
+        return 1;
+    }
+    
+    double start = now_sec();
+    for (int i = 0; i < o->conns; i++) {
+        ws[i].o = o;
+        ws[i].deadline = start + o->seconds;
+        if (make_addr(o, &ws[i].addr) < 0) {
+            return 1;
+        }
+        if (pthread_create(&ws[i].tid, NULL, oneshot_thread, &ws[i]) != 0) {
+            perror("pthread_create error");
+            return 1;
+        }
+    }
+    
+    uint64_t completed = 0, failed = 0;
+    latency_log_t lat = { NULL, 0, 0 };
+    for (int i = 0; i < o->conns; i++) {
+        pthread_join(ws[i].tid, NULL);
+        completed += ws[i].completed;
+        failed += ws[i].failed;
+        latency_merge(&lat, &ws[i].lat);
+        free(ws[i].lat.us);
+    }
+    double elapsed = now_sec() - start;
+    
+    printf("=== 短连接负载测试结果 ===\n");
+    printf("目标: %s:%d，并发: %d，请求: %d 字节\n", o->host, o->port, o->conns, o->size);
+    printf("完成 %llu 个连接，失败 %llu 个，耗时 %.2f 秒\n",
+           (unsigned long long)completed, (unsigned long long)failed, elapsed);
+    printf("吞吐量: %.0f 连接/秒\n", completed / elapsed);
+    latency_report(&lat);
+    
+    free(lat.us);
+    free(ws);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// UDP 模式：每个套接字（不同源端口，由 SO_REUSEPORT 分散到不同分片）
+// 每轮批量发送 batch 个数据报，再批量收取回显
+// ---------------------------------------------------------------------------
+
+typedef struct udp_stats {
+    uint64_t sent;
+    uint64_t received;
+    uint64_t send_calls;
+    uint64_t recv_calls;
+    uint64_t poll_calls;
+} udp_stats_t;
+
+// 发送一轮数据报，返回实际发出的个数
+static int udp_send_round(int fd, const load_options_t *o, char *payload,
+                          struct mmsghdr *msgs, struct iovec *iovs, udp_stats_t *st) {
+    if (o->gso) {
+        // 一次 sendmsg 携带 batch 段，由内核分段
+        struct iovec iov = { payload, (size_t)o->size * o->batch };
+        char cbuf[CMSG_SPACE(sizeof(uint16_t))];
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        memset(cbuf, 0, sizeof(cbuf));
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = cbuf;
+        mh.msg_controllen = sizeof(cbuf);
+        struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+        cm->cmsg_level = SOL_UDP;
+        cm->cmsg_type = UDP_SEGMENT;
+        cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t seg = (uint16_t)o->size;
+        memcpy(CMSG_DATA(cm), &seg, sizeof(seg));
+        
+        st->send_calls++;
+        if (sendmsg(fd, &mh, 0) < 0) {
+            return 0;
+        }
+        return o->batch;
+    }
+    
+    for (int i = 0; i < o->batch; i++) {
+        iovs[i].iov_base = payload + (size_t)i * o->size;
+        iovs[i].iov_len = o->size;
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    
+    int sent = 0;
+    while (sent < o->batch) {
+        st->send_calls++;
+        int r = sendmmsg(fd, msgs + sent, o->batch - sent, 0);
+        if (r <= 0) {
+            break;
+        }
+        sent += r;
+    }
+    return sent;
+}
+
+static int run_udp(const load_options_t *o) {
+    struct sockaddr_in addr;
+    if (make_addr(o, &addr) < 0) {
+        return 1;
+    }
+    
+    int *fds = (int *)calloc(o->conns, sizeof(int));
+    int *pending = (int *)calloc(o->conns, sizeof(int));
+    struct pollfd *pfds = (struct pollfd *)calloc(o->conns, sizeof(struct pollfd));
+    char *payload = (char *)malloc((size_t)o->size * o->batch);
+    char *rbuf = (char *)malloc((size_t)UDP_RECV_SLOT * o->batch);
+    struct mmsghdr *msgs = (struct mmsghdr *)calloc(o->batch, sizeof(*msgs));
+    struct iovec *iovs = (struct iovec *)calloc(o->batch, sizeof(*iovs));
+    if (fds == NULL || pending == NULL || pfds == NULL || payload == NULL ||
+        rbuf == NULL || msgs == NULL || iovs == NULL) {
+        perror("malloc error");
+        return 1;
+    }
+    memset(payload, 'x', (size_t)o->size * o->batch);
+    
+    for (int i = 0; i < o->conns; i++) {
+        fds[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fds[i] < 0 || connect(fds[i], (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            perror("udp socket/connect error");
+            return 1;
+        }
+        int rcvbuf = 4 * 1024 * 1024;
+        setsockopt(fds[i], SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        pfds[i].fd = fds[i];
+    }
+    
+    udp_stats_t st;
+    memset(&st, 0, sizeof(st));
+    double start = now_sec();
+    double deadline = start + o->seconds;
+    
+    while (now_sec() < deadline) {
+        // 每个套接字发出一批
+        int outstanding = 0;
+        for (int i = 0; i < o->conns; i++) {
+            pending[i] = udp_send_round(fds[i], o, payload, msgs, iovs, &st);
+            st.sent += pending[i];
+            outstanding += pending[i];
+        }
+        
+        // 收取回显，直到全部收到或超时
+        while (outstanding > 0) {
+            for (int i = 0; i < o->conns; i++) {
+                pfds[i].events = pending[i] > 0 ? POLLIN : 0;
+                pfds[i].revents = 0;
+            }
+            st.poll_calls++;
+            int pr = poll(pfds, o->conns, UDP_REPLY_TIMEOUT_MS);
+            if (pr <= 0) {
+                break;
+            }
+            
+            for (int i = 0; i < o->conns; i++) {
+                if (!(pfds[i].revents & POLLIN)) {
+                    continue;
+                }
+                for (int k = 0; k < pending[i]; k++) {
+                    iovs[k].iov_base = rbuf + (size_t)k * UDP_RECV_SLOT;
+                    iovs[k].iov_len = UDP_RECV_SLOT;
+                    memset(&msgs[k].msg_hdr, 0, sizeof(msgs[k].msg_hdr));
+                    msgs[k].msg_hdr.msg_iov = &iovs[k];
+                    msgs[k].msg_hdr.msg_iovlen = 1;
+                }
+                st.recv_calls++;
+                int r = recvmmsg(fds[i], msgs, pending[i], MSG_DONTWAIT, NULL);
+                if (r > 0) {
+                    pending[i] -= r;
+                    outstanding -= r;
+                    st.received += r;
+                }
+            }
+        }
+    }
+    
+    double elapsed = now_sec() - start;
+    
+    printf("=== UDP 负载测试结果 ===\n");
+    printf("目标: %s:%d，套接字: %d，批量: %d，负载: %d 字节，GSO: %s\n",
+           o->host, o->port, o->conns, o->batch, o->size, o->gso ? "开启" : "关闭");
+    printf("发送 %llu，收到 %llu，丢失 %llu，耗时 %.2f 秒\n",
+           (unsigned long long)st.sent, (unsigned long long)st.received,
+           (unsigned long long)(st.sent - st.received), elapsed);
+    printf("吞吐量: %.0f 数据报/秒（往返）\n", st.received / elapsed);
+    if (st.received > 0) {
+        printf("客户端系统调用/数据报: 发送 %.3f，接收 %.3f，poll %.3f\n",
+               (double)st.send_calls / st.sent, (double)st.recv_calls / st.received,
+               (double)st.poll_calls / st.received);
+    }
+    
+    for (int i = 0; i < o->conns; i++) {
+        close(fds[i]);
+    }
+    free(fds);
+    free(pending);
+    free(pfds);
+    free(payload);
+    free(rbuf);
+    free(msgs);
+    free(iovs);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// kv 模式：memcached 文本协议。先预填充全部键，然后每个线程一个连接，
+// 每轮流水线发送 batch 个 get/set，再读完全部响应，测量每秒操作数和每轮往返延迟
+// ---------------------------------------------------------------------------
+
+typedef struct kv_worker {
+    const load_options_t *o;
+    struct sockaddr_in addr;
+    double deadline;
+    uint64_t seed;
+    uint64_t ops;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t errors;
+    latency_log_t lat;
+    pthread_t tid;
+    int failed;
+} kv_worker_t;
+
+// 响应读取状态
+typedef struct kv_reader {
+    int fd;
+    char *buf;
+    size_t len;
+    size_t pos;
+} kv_reader_t;
+
+static uint64_t xorshift64(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *s = x;
+    return x;
+}
+
+static int kv_connect(const struct sockaddr_in *addr) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct timeval tv = { ONESHOT_TIMEOUT_SECS, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    if (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int kv_send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t w = send(fd, buf, len, MSG_NOSIGNAL);
+        if (w <= 0) {
+            return -1;
+        }
+        buf += w;
+        len -= w;
+    }
+    return 0;
+}
+
+// 读取一行（含 \r\n），必要时从套接字补充数据；返回行首，*n 为不含 \r\n 的长度
+static char *kv_read_line(kv_reader_t *r, size_t *n) {
+    for (;;) {
+        char *nl = (char *)memchr(r->buf + r->pos, '\n', r->len - r->pos);
+        if (nl != NULL) {
+            char *line = r->buf + r->pos;
+            r->pos = nl + 1 - r->buf;
+            *n = (nl > line && nl[-1] == '\r') ? (size_t)(nl - 1 - line) : (size_t)(nl - line);
+            return line;
+        }
+        if (r->pos > 0) {
+            memmove(r->buf, r->buf + r->pos, r->len - r->pos);
+            r->len -= r->pos;
+            r->pos = 0;
+        }
+        if (r->len == KV_RECV_BUFFER) {
+            return NULL;
+        }
+        ssize_t got = recv(r->fd, r->buf + r->len, KV_RECV_BUFFER - r->len, 0);
+        if (got <= 0) {
+            return NULL;
+        }
+        r->len += got;
+    }
+}
+
+// 跳过 n 字节数据块
+static int kv_skip(kv_reader_t *r, size_t n) {
+    while (r->len - r->pos < n) {
+        n -= r->len - r->pos;
+        r->pos = r->len = 0;
+        ssize_t got = recv(r->fd, r->buf, KV_RECV_BUFFER, 0);
+        if (got <= 0) {
+            return -1;
+        }
+        r->len = got;
+    }
+    r->pos += n;
+    return 0;
+}
+
+// 读取一条完整响应：get 读到 END（其间的 VALUE 计为命中），其他命令读一行
+static int kv_read_reply(kv_reader_t *r, kv_worker_t *w) {
+    size_t n;
+    char *line;
+    int values = 0;
+    
+    while ((line = kv_read_line(r, &n)) != NULL) {
+        if (n > 6 && memcmp(line, "VALUE ", 6) == 0) {
+            // VALUE <key> <flags> <bytes>
+            char *sp = (char *)memrchr(line, ' ', n);
+            size_t bytes = strtoul(sp + 1, NULL, 10);
+            if (kv_skip(r, bytes + 2) < 0) {
+                return -1;
+            }
+            values++;
+            continue;
+        }
+        if (n == 3 && memcmp(line, "END", 3) == 0) {
+            if (values > 0) {
+                w->hits++;
+            } else {
+                w->misses++;
+            }
+            return 0;
+        }
+        if (!(n == 6 && memcmp(line, "STORED", 6) == 0)) {
+            w->errors++;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+static size_t kv_append_request(char *p, const load_options_t *o, const char *value,
+                                uint64_t key, int is_set) {
+    if (is_set) {
+        int len = sprintf(p, "set key:%llu 0 0 %d\r\n", (unsigned long long)key, o->size);
+        memcpy(p + len, value, o->size);
+        memcpy(p + len + o->size, "\r\n", 2);
+        return len + o->size + 2;
+    }
+    return sprintf(p, "get key:%llu\r\n", (unsigned long long)key);
+}
+
+// 预填充：用一个连接以 noreply 流水线写入全部键，最后用 version 确认处理完毕
+static int kv_populate(const load_options_t *o, const struct sockaddr_in *addr, const char *value) {
+    int fd = kv_connect(addr);
+    if (fd < 0) {
+        perror("connect error");
+        return -1;
+    }
+    char *req = (char *)malloc((size_t)KV_POPULATE_BATCH * (o->size + 64));
+    for (int k = 0; k < o->keys; k += KV_POPULATE_BATCH) {
+        size_t len = 0;
+        for (int i = k; i < o->keys && i < k + KV_POPULATE_BATCH; i++) {
+            len += sprintf(req + len, "set key:%d 0 0 %d noreply\r\n", i, o->size);
+            memcpy(req + len, value, o->size);
+            memcpy(req + len + o->size, "\r\n", 2);
+            len += o->size + 2;
+        }
+        if (kv_send_all(fd, req, len) < 0) {
+            free(req);
+            close(fd);
+            return -1;
+        }
+    }
+    free(req);
+    
+    char reply[64];
+    int ok = kv_send_all(fd, "version\r\n", 9) == 0 && recv(fd, reply, sizeof(reply), 0) > 0;
+    close(fd);
+    return ok ? 0 : -1;
+}
+
+static void *kv_thread(void *arg) {
+    kv_worker_t *w = (kv_worker_t *)arg;
+    const load_options_t *o = w->o;
+    char *value = (char *)malloc(o->size);
+    char *req = (char *)malloc((size_t)o->batch * (o->size + 64));
+    kv_reader_t r = { -1, (char *)malloc(KV_RECV_BUFFER), 0, 0 };
+    memset(value, 'v', o->size);
+    
+    r.fd = kv_connect(&w->addr);
+    if (r.fd < 0) {
+        w->failed = 1;
+        goto out;
+    }
+    
+    while (now_sec() < w->deadline) {
+        size_t len = 0;
+        for (int i = 0; i < o->batch; i++) {
+            uint64_t x = xorshift64(&w->seed);
+            int is_set = (int)(x % 100) < o->set_percent;
+            len += kv_append_request(req + len, o, value, (x >> 8) % o->keys, is_set);
+        }
+        
+        double t0 = now_sec();
+        if (kv_send_all(r.fd, req, len) < 0) {
+            w->failed = 1;
+            break;
+        }
+        for (int i = 0; i < o->batch; i++) {
+            if (kv_read_reply(&r, w) < 0) {
+                w->failed = 1;
+                goto out;
+            }
+        }
+        latency_add(&w->lat, (now_sec() - t0) * 1e6);
+        w->ops += o->batch;
+    }
+    
+out:
+    if (r.fd >= 0) {
+        close(r.fd);
+    }
+    free(r.buf);
+    free(req);
+    free(value);
+    return NULL;
+}
+
+static int run_kv(const load_options_t *o) {
+    struct sockaddr_in addr;
+    if (make_addr(o, &addr) < 0) {
+        return 1;
+    }
+    
+    char *value = (char *)malloc(o->size);
+    memset(value, 'v', o->size);
+    double t0 = now_sec();
+    if (kv_populate(o, &addr, value) < 0) {
+        fprintf(stderr, "预填充失败\n");
+        free(value);
+        return 1;
+    }
+    printf("预填充 %d 个键（%d 字节）用时 %.2f 秒\n", o->keys, o->size, now_sec() - t0);
+    free(value);
+    
+    kv_worker_t *ws = (kv_worker_t *)calloc(o->conns, sizeof(*ws));
+    if (ws == NULL) {
+        perror("malloc error");
+        return 1;
+    }
+    
+    double start = now_sec();
+    for (int i = 0; i < o->conns; i++) {
+        ws[i].o = o;
+        ws[i].addr = addr;
+        ws[i].deadline = start + o->seconds;
+        ws[i].seed = 0x9E3779B97F4A7C15ULL * (i + 1);
+        if (pthread_create(&ws[i].tid, NULL, kv_thread, &ws[i]) != 0) {
+            perror("pthread_create error");
+            return 1;
+        }
+    }
+    
+    uint64_t ops = 0, hits = 0, misses = 0, errors = 0;
+    int failed = 0;
+    latency_log_t lat = { NULL, 0, 0 };
+    for (int i = 0; i < o->conns; i++) {
+        pthread_join(ws[i].tid, NULL);
+        ops += ws[i].ops;
+        hits += ws[i].hits;
+        misses += ws[i].misses;
+        errors += ws[i].errors;
+        failed += ws[i].failed;
+        latency_merge(&lat, &ws[i].lat);
+        free(ws[i].lat.us);
+    }
+    double elapsed = now_sec() - start;
+    
+    printf("=== KV 负载测试结果 ===\n");
+    printf("目标: %s:%d，连接: %d，流水线深度: %d，键: %d，值: %d 字节，set: %d%%\n",
+           o->host, o->port, o->conns, o->batch, o->keys, o->size, o->set_percent);
+    printf("完成 %llu 个操作，耗时 %.2f 秒，失败连接 %d 个，错误响应 %llu 个\n",
+           (unsigned long long)ops, elapsed, failed, (unsigned long long)errors);
+    printf("吞吐量: %.0f 操作/秒", ops / elapsed);
+    if (hits + misses > 0) {
+        printf("，get 命中率 %.1f%%", 100.0 * hits / (hits + misses));
+    }
+    printf("\n");
+    printf("（延迟为每轮 %d 个流水线请求的往返时间）\n", o->batch);
+    latency_report(&lat);
+    
+    free(lat.us);
+    free(ws);
+    return failed == o->conns ? 1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// http 模式：每个线程用 epoll 驱动一组长连接（可达上万个），每个连接每轮
+// 流水线发送 batch 个 GET，收齐响应后记录往返延迟并立即发送下一轮
+// ---------------------------------------------------------------------------
+
+typedef struct http_client_conn {
+    int fd;
+    int connected;
+    int pending;                 // 本轮尚未收到的响应数
+    double sent_at;
+    size_t len;                  // 接收缓冲区中的数据
+    char *buf;
+} http_client_conn_t;
+
+typedef struct http_worker {
+    const load_options_t *o;
+    struct sockaddr_in addr;
+    int nconns;
+    double deadline;
+    uint64_t requests;
+    uint64_t errors;             // 连接失败或被关闭
+    uint64_t bad_status;         // 非 200 响应
+    latency_log_t lat;
+    pthread_t tid;
+} http_worker_t;
+
+// 解析一个完整响应，返回其长度，不完整返回0，格式错误返回 -1
+static ssize_t http_parse_response(const char *buf, size_t len, int *status) {
+    const char *end = (const char *)memmem(buf, len, "\r\n\r\n", 4);
+    if (end == NULL) {
+        return 0;
+    }
+    size_t head = end + 4 - buf;
+    if (head < 12 || memcmp(buf, "HTTP/1.", 7) != 0) {
+        return -1;
+    }
+    *status = atoi(buf + 9);
+    
+    size_t body = 0;
+    for (const char *p = buf; p < end; ) {
+        const char *nl = (const char *)memchr(p, '\n', end - p);
+        if (nl == NULL) {
+            break;
+        }
+        p = nl + 1;
+        if (end - p > 15 && strncasecmp(p, "Content-Length:", 15) == 0) {
+            body = strtoul(p + 15, NULL, 10);
+        }
+    }
+    return head + body <= len ? (ssize_t)(head + body) : 0;
+}
+
+static int http_send_batch(http_client_conn_t *c, const char *req, size_t req_len, int batch) {
+    c->sent_at = now_sec();
+    c->pending = batch;
+    // 请求很小，一次 send 即可写入空的发送缓冲区
+    return send(c->fd, req, req_len, MSG_NOSIGNAL) == (ssize_t)req_len ? 0 : -1;
+}
+
+static void http_conn_close(int ep, http_client_conn_t *c) {
+    if (c->fd >= 0) {
+        epoll_ctl(ep, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        c->fd = -1;
+    }
+}
+
+static void *http_thread(void *arg) {
+    http_worker_t *w = (http_worker_t *)arg;
+    const load_options_t *o = w->o;
+    int ep = epoll_create1(0);
+    http_client_conn_t *conns = (http_client_conn_t *)calloc(w->nconns, sizeof(*conns));
+    struct epoll_event *evs = (struct epoll_event *)calloc(w->nconns, sizeof(*evs));
+    
+    char req[HTTP_MAX_BATCH * 128];
+    size_t req_len = 0;
+    for (int i = 0; i < o->batch; i++) {
+        req_len += sprintf(req + req_len, "GET / HTTP/1.1\r\nHost: %s\r\n\r\n", o->host);
+    }
+    
+    int open_conns = 0;
+    for (int i = 0; i < w->nconns; i++) {
+        http_client_conn_t *c = &conns[i];
+        c->buf = (char *)malloc(HTTP_RECV_BUFFER);
+        c->fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (c->fd < 0) {
+            w->errors++;
+            continue;
+        }
+        int on = 1;
+        setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL, 0) | O_NONBLOCK);
+        if (connect(c->fd, (struct sockaddr *)&w->addr, sizeof(w->addr)) < 0 &&
+            errno != EINPROGRESS) {
+            close(c->fd);
+            c->fd = -1;
+            w->errors++;
+            continue;
+        }
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT;
+        ev.data.u32 = i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, c->fd, &ev);
+        open_conns++;
+    }
+    
+    while (open_conns > 0 && now_sec() < w->deadline) {
+        int n = epoll_wait(ep, evs, w->nconns, 100);
+        for (int k = 0; k < n; k++) {
+            http_client_conn_t *c = &conns[evs[k].data.u32];
+            if (c->fd < 0) {
+                continue;
+            }
+            
+            if (!c->connected) {
+                int err = 0;
+                socklen_t elen = sizeof(err);
+                getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &elen);
+                if (err != 0 || !(evs[k].events & EPOLLOUT)) {
+                    w->errors++;
+                    http_conn_close(ep, c);
+                    open_conns--;
+                    continue;
+                }
+                // 连接建立后只关注可读
+                struct epoll_event ev;
+                ev.events = EPOLLIN;
+                ev.data.u32 = evs[k].data.u32;
+                epoll_ctl(ep, EPOLL_CTL_MOD, c->fd, &ev);
+                c->connected = 1;
+                if (http_send_batch(c, req, req_len, o->batch) < 0) {
+                    w->errors++;
+                    http_conn_close(ep, c);
+                    open_conns--;
+                }
+                continue;
+            }
+            
+            ssize_t r = recv(c->fd, c->buf + c->len, HTTP_RECV_BUFFER - c->len, 0);
+            if (r <= 0) {
+                if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    continue;
+                }
+                w->errors++;
+                http_conn_close(ep, c);
+                open_conns--;
+                continue;
+            }
+            c->len += r;
+            
+            size_t off = 0;
+            int status;
+            ssize_t m;
+            while (c->pending > 0 &&
+                   (m = http_parse_response(c->buf + off, c->len - off, &status)) > 0) {
+                off += m;
+                c->pending--;
+                w->requests++;
+                if (status != 200) {
+                    w->bad_status++;
+                }
+            }
+            c->len -= off;
+            memmove(c->buf, c->buf + off, c->len);
+            
+            if (c->pending == 0) {
+                latency_add(&w->lat, (now_sec() - c->sent_at) * 1e6);
+                if (now_sec() < w->deadline && http_send_batch(c, req, req_len, o->batch) < 0) {
+                    w->errors++;
+                    http_conn_close(ep, c);
+                    open_conns--;
+                }
+            } else if (c->len == HTTP_RECV_BUFFER) {
+                w->errors++;
+                http_conn_close(ep, c);
+                open_conns--;
+            }
+        }
+    }
+    
+    for (int i = 0; i < w->nconns; i++) {
+        http_conn_close(ep, &conns[i]);
+        free(conns[i].buf);
+    }
+    free(conns);
+    free(evs);
+    close(ep);
+    return NULL;
+}
+
+static int run_http(const load_options_t *o) {
+    struct sockaddr_in addr;
+    if (make_addr(o, &addr) < 0) {
+        return 1;
+    }
+    
+    // 连接平均分给每个 CPU 一个线程
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = ncpu > 0 ? (int)ncpu : 1;
+    if (nthreads > o->conns) {
+        nthreads = o->conns;
+    }
+    
+    http_worker_t *ws = (http_worker_t *)calloc(nthreads, sizeof(*ws));
+    if (ws == NULL) {
+        perror("malloc error");
+        return 1;
+    }
+    
+    double start = now_sec();
+    for (int i = 0; i < nthreads; i++) {
+        ws[i].o = o;
+        ws[i].addr = addr;
+        ws[i].nconns = o->conns / nthreads + (i < o->conns % nthreads);
+        ws[i].deadline = start + o->seconds;
+        if (pthread_create(&ws[i].tid, NULL, http_thread, &ws[i]) != 0) {
+            perror("pthread_create error");
+            return 1;
+        }
+    }
+    
+    uint64_t requests = 0, errors = 0, bad_status = 0;
+    latency_log_t lat = { NULL, 0, 0 };
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(ws[i].tid, NULL);
+        requests += ws[i].requests;
+        errors += ws[i].errors;
+        bad_status += ws[i].bad_status;
+        latency_merge(&lat, &ws[i].lat);
+        free(ws[i].lat.us);
+    }
+    double elapsed = now_sec() - start;
+    
+    printf("=== HTTP 负载测试结果 ===\n");
+    printf("目标: %s:%d，连接: %d，线程: %d，流水线深度: %d\n",
+           o->host, o->port, o->conns, nthreads, o->batch);
+    printf("完成 %llu 个请求，耗时 %.2f 秒，连接错误 %llu 个，非200响应 %llu 个\n",
+           (unsigned long long)requests, elapsed, (unsigned long long)errors,
+           (unsigned long long)bad_status);
+    printf("吞吐量: %.0f 请求/秒\n", requests / elapsed);
+    if (o->batch > 1) {
+        printf("（延迟为每轮 %d 个流水线请求的往返时间）\n", o->batch);
+    }
+    latency_report(&lat);
+    
+    free(lat.us);
+    free(ws);
+    return errors == (uint64_t)o->conns ? 1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// stream 模式：每个线程一个连接，全双工地持续发送 size 字节的块并读取回显
+// （未回显的数据不超过 STREAM_WINDOW_CHUNKS 块）。结束时半关闭，读到 EOF 为止，
+// 检查回显的字节数与发送的一致（验证半关闭能穿过代理）
+// ---------------------------------------------------------------------------
+
+typedef struct stream_worker {
+    const load_options_t *o;
+    struct sockaddr_in addr;
+    double deadline;
+    uint64_t sent;
+    uint64_t received;
+    int failed;
+    pthread_t tid;
+} stream_worker_t;
+
+static void *stream_thread(void *arg) {
+    stream_worker_t *w = (stream_worker_t *)arg;
+    const load_options_t *o = w->o;
+    char *payload = (char *)malloc(o->size);
+    char *buf = (char *)malloc(STREAM_RECV_BUFFER);
+    uint64_t window = (uint64_t)o->size * STREAM_WINDOW_CHUNKS;
+    memset(payload, 's', o->size);
+    
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&w->addr, sizeof(w->addr)) < 0) {
+        w->failed = 1;
+        goto out;
+    }
+    
+    int shut = 0;
+    for (;;) {
+        if (!shut && now_sec() >= w->deadline) {
+            shutdown(fd, SHUT_WR);
+            shut = 1;
+        }
+        
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (!shut && w->sent - w->received < window) {
+            pfd.events |= POLLOUT;
+        }
+        int pr = poll(&pfd, 1, ONESHOT_TIMEOUT_SECS * 1000);
+        if (pr <= 0) {
+            w->failed = 1;
+            break;
+        }
+        
+        if (pfd.revents & POLLOUT) {
+            ssize_t n = send(fd, payload, o->size, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n > 0) {
+                w->sent += n;
+            } else if (n < 0 && errno != EAGAIN) {
+                w->failed = 1;
+                break;
+            }
+        }
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t n = recv(fd, buf, STREAM_RECV_BUFFER, MSG_DONTWAIT);
+            if (n > 0) {
+                w->received += n;
+            } else if (n == 0) {
+                break;
+            } else if (errno != EAGAIN) {
+                w->failed = 1;
+                break;
+            }
+        }
+    }
+    if (w->received != w->sent) {
+        w->failed = 1;
+    }
+    
+out:
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(payload);
+    free(buf);
+    return NULL;
+}
+
+static int run_stream(const load_options_t *o) {
+    stream_worker_t *ws = (stream_worker_t *)calloc(o->conns, sizeof(*ws));
+    if (ws == NULL) {
+        perror("malloc error");
+        return 1;
+    }
+    
+    double start = now_sec();
+    for (int i = 0; i < o->conns; i++) {
+        ws[i].o = o;
+        ws[i].deadline = start + o->seconds;
+        if (make_addr(o, &ws[i].addr) < 0) {
+            return 1;
+        }
+        if (pthread_create(&ws[i].tid, NULL, stream_thread, &ws[i]) != 0) {
+            perror("pthread_create error");
+            return 1;
+        }
+    }
+    
+    uint64_t sent = 0, received = 0;
+    int failed = 0;
+    for (int i = 0; i < o->conns; i++) {
+        pthread_join(ws[i].tid, NULL);
+        sent += ws[i].sent;
+        received += ws[i].received;
+        failed += ws[i].failed;
+    }
+    double elapsed = now_sec() - start;
+    
+    printf("=== 流式负载测试结果 ===\n");
+    printf("目标: %s:%d，连接: %d，块大小: %d 字节\n", o->host, o->port, o->conns, o->size);
+    printf("发送 %.3f GB，收到回显 %.3f GB，耗时 %.2f 秒，未完整回显的连接 %d 个\n",
+           sent / 1e9, received / 1e9, elapsed, failed);
+    printf("吞吐量: %.1f MB/s（每个方向）\n", received / elapsed / 1e6);
+    
+    free(ws);
+    return failed > 0 ? 1 : 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "使用方法: %s <模式> [选项]\n", prog);
+    fprintf(stderr, "模式:\n");
+    fprintf(stderr, "  udp      UDP echo（批量 sendmmsg/recvmmsg）\n");
+    fprintf(stderr, "  oneshot TCP echo 短连接（每个连接一次请求，-c 为并发线程数）\n");
+    fprintf(stderr, "  http     HTTP/1.1 长连接（epoll 驱动，-c 可达上万，-b 为流水线深度，默认 1）\n");
+    fprintf(stderr, "  stream   TCP echo 流式吞吐（每个线程一个连接，-s 为块大小，结束时半关闭并校验回显）\n");
+    fprintf(stderr, "  kv       memcached 文本协议（每个线程一个连接，-b 为流水线深度，-s 为值大小）\n");
+    fprintf(stderr, "选项:\n");
+    fprintf(stderr, "  -h 主机   服务器地址（默认 %s）\n", DEFAULT_HOST);
+    fprintf(stderr, "  -p 端口   服务器端口（默认 %d）\n", DEFAULT_PORT);
+    fprintf(stderr, "  -c 数量   连接/套接字数量（默认 1）\n");
+    fprintf(stderr, "  -b 批量   每轮每个套接字/连接的请求数（默认 32，http 为 1）\n");
+    fprintf(stderr, "  -s 字节   负载大小（默认 64）\n");
+    fprintf(stderr, "  -d 秒     持续时间（默认 %d）\n", DEFAULT_SECONDS);
+    fprintf(stderr, "  -g        UDP：使用 UDP_SEGMENT 一次发送整批\n");
+    fprintf(stderr, "  -k 数量   kv：键空间大小（默认 %d）\n", KV_DEFAULT_KEYS);
+    fprintf(stderr, "  -r 百分比 kv：set 请求占比（默认 %d）\n", KV_DEFAULT_SET_PERCENT);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    
+    const char *mode = argv[1];
+    load_options_t o = { DEFAULT_HOST, DEFAULT_PORT, 1, 0, 64, DEFAULT_SECONDS, 0,
+                         KV_DEFAULT_KEYS, KV_DEFAULT_SET_PERCENT };
+    int opt;
+    
+    optind = 2;
+    while ((opt = getopt(argc, argv, "h:p:c:b:s:d:gk:r:")) != -1) {
+        switch (opt) {
+        case 'h': o.host = optarg; break;
+        case 'p': o.port = atoi(optarg); break;
+        case 'c': o.conns = atoi(optarg); break;
+        case 'b': o.batch = atoi(optarg); break;
+        case 's': o.size = atoi(optarg); break;
+        case 'd': o.seconds = atoi(optarg); break;
+        case 'g': o.gso = 1; break;
+        case 'k': o.keys = atoi(optarg); break;
+        case 'r': o.set_percent = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    // 未指定 -b 时 http 不使用流水线，其他模式每轮 32 个
+    if (o.batch == 0) {
+        o.batch = strcmp(mode, "http") == 0 ? 1 : 32;
+    }
+    
+    if (o.conns <= 0 || o.batch <= 0 || o.size <= 0 || o.seconds <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    
+    if (strcmp(mode, "udp") == 0) {
+        if (o.batch > UDP_MAX_BATCH || o.size > UDP_RECV_SLOT) {
+            fprintf(stderr, "UDP 批量不超过 %d，负载不超过 %d 字节\n", UDP_MAX_BATCH, UDP_RECV_SLOT);
+            return 1;
+        }
+        if (o.gso && (o.batch > UDP_GSO_MAX_SEGMENTS || o.size * o.batch > UDP_GSO_MAX_BYTES)) {
+            fprintf(stderr, "GSO 模式下批量不超过 %d 段且总长不超过 %d 字节\n",
+                    UDP_GSO_MAX_SEGMENTS, UDP_GSO_MAX_BYTES);
+            return 1;
+        }
+        return run_udp(&o);
+    }
+    
+    if (strcmp(mode, "oneshot") == 0) {
+        return run_oneshot(&o);
+    }
+    
+    if (strcmp(mode, "http") == 0) {
+        if (o.batch > HTTP_MAX_BATCH) {
+            fprintf(stderr, "HTTP 流水线深度不超过 %d\n", HTTP_MAX_BATCH);
+            return 1;
+        }
+        return run_http(&o);
+    }
+    
+    if (strcmp(mode, "stream") == 0) {
+        return run_stream(&o);
+    }
+    
+    if (strcmp(mode, "kv") == 0) {
+        if (o.keys <= 0 || o.set_percent < 0 || o.set_percent > 100) {
+            usage(argv[0]);
+            return 1;
+        }
+        return run_kv(&o);
+    }
+    
+    fprintf(stderr, "未知模式: %s\n", mode);
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,128 @@
+#define _GNU_SOURCE
+#include "net.h"
+#include "reactor.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+int net_set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return -1;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+int net_listen_tcp(int port, int backlog, int reuseport) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket error");
+        return -1;
+    }
+    
+    int on = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+        (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0)) {
+        perror("setsockopt error");
+        close(fd);
+        return -1;
+    }
+    
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind error");
+        close(fd);
+        return -1;
+    }
+    
+    if (net_set_nonblocking(fd) < 0 || listen(fd, backlog) < 0) {
+        perror("listen error");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int net_connect_tcp(const char *host, int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) <= 0) {
+        fprintf(stderr, "无效的地址: %s\n", host);
+        return -1;
+    }
+    
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket error");
+        return -1;
+    }
+    if (net_set_nonblocking(fd) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int net_send_all(int fd, const char *buf, size_t len) {
+    return net_send_all_timeout(fd, buf, len, -1);
+}
+
+int net_send_all_timeout(int fd, const char *buf, size_t len, int timeout_ms) {
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t w = send(fd, buf + sent, len - sent, MSG_NOSIGNAL);
+        if (w < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // 等待失败（fd 未注册或已有写等待者）时重试只会空转
+                int r = reactor_wait_timeout(fd, EPOLLOUT, timeout_ms);
+                if (r < 0) {
+                    return -1;
+                }
+                if (r == 1) {
+                    errno = ETIMEDOUT;
+                    return -1;
+                }
+                continue;
+            } else if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        sent += w;
+    }
+    return 0;
+}
+
+ssize_t net_recv(int fd, char *buf, size_t len) {
+    for (;;) {
+        ssize_t n = recv(fd, buf, len, 0);
+        if (n >= 0) {
+            return n;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (reactor_wait(fd, EPOLLIN) < 0) {
+                return -1;
+            }
+            continue;
+        } else if (errno == EINTR) {
+            continue;
+        }
+        return -1;
+    }
+}
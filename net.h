@@ -0,0 +1,59 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * 设置文件描述符为非阻塞模式
+ * @param fd 文件描述符
+ * @return 0 成功，-1 失败
+ */
+int net_set_nonblocking(int fd);
+
+/**
+ * 创建非阻塞的 TCP 监听套接字（INADDR_ANY）
+ * @param port 监听端口
+ * @param backlog listen 队列长度
+ * @param reuseport 非0时设置 SO_REUSEPORT，允许多个线程各自监听同一端口
+ * @return 套接字，失败返回 -1
+ */
+int net_listen_tcp(int port, int backlog, int reuseport);
+
+/**
+ * 创建非阻塞的 TCP 连接（连接在后台进行，首次可写表示完成）
+ * @param host IPv4 地址
+ * @param port 端口
+ * @return 套接字，失败返回 -1
+ */
+int net_connect_tcp(const char *host, int port);
+
+/**
+ * 发送全部数据，发送缓冲区满时挂起当前协程等待可写（fd 须已注册到 reactor）
+ * @param fd 非阻塞套接字
+ * @param buf 数据
+ * @param len 长度
+ * @return 0 成功，-1 失败（errno 为 send 或 reactor_wait 的错误）
+ */
+int net_send_all(int fd, const char *buf, size_t len);
+
+/**
+ * 同 net_send_all，但每次等待可写最多 timeout_ms 毫秒（对端长期不读时放弃）
+ * @param fd 非阻塞套接字
+ * @param buf 数据
+ * @param len 长度
+ * @param timeout_ms 每次等待的超时（毫秒），负数表示不超时
+ * @return 0 成功，-1 失败（超时时 errno 为 ETIMEDOUT）
+ */
+int net_send_all_timeout(int fd, const char *buf, size_t len, int timeout_ms);
+
+/**
+ * 接收数据，没有数据时挂起当前协程等待可读（fd 须已注册到 reactor）
+ * @param fd 非阻塞套接字
+ * @param buf 缓冲区
+ * @param len 缓冲区大小
+ * @return 接收的字节数，0 表示对端关闭，-1 表示错误（errno 为 recv 或 reactor_wait 的错误）
+ */
+ssize_t net_recv(int fd, char *buf, size_t len);
+
+#endif // NET_H
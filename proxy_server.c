@@ -0,0 +1,403 @@
+#define _GNU_SOURCE
+#include "proxy_server.h"
+#include "reactor.h"
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+static proxy_server_t *server = NULL;
+static volatile int running = 1;
+
+// 方向协程的启动参数，只在协程首次挂起之前有效
+typedef struct proxy_dir {
+    proxy_conn_t *conn;
+    int src;
+    int dst;
+    uint64_t *bytes;             // 该方向的字节计数
+} proxy_dir_t;
+
+// 方向结束的原因
+#define PROXY_EOF 0              // 读到 EOF，已半关闭目标端
+#define PROXY_ERROR -1           // 出错，两端都已关闭读写
+
+// 用 splice 转发：src → 管道 → dst，数据不经过用户态
+// 每轮先把管道清空再读，因此读入时管道总有空间；管道本身不需要注册到 reactor
+static int forward_splice(int src, int dst, uint64_t *bytes) {
+    int pipefd[2];
+    if (pipe2(pipefd, O_NONBLOCK | O_CLOEXEC) < 0) {
+        perror("pipe2 error");
+        return PROXY_ERROR;
+    }
+    
+    int rc = PROXY_ERROR;
+    for (;;) {
+        ssize_t n = splice(src, NULL, pipefd[1], NULL, PROXY_CHUNK_SIZE,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        server->io_calls++;
+        if (n == 0) {
+            rc = PROXY_EOF;
+            break;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN) {
+                // 等待失败（fd 未注册或已有等待者）时重试只会空转
+                if (reactor_wait(src, EPOLLIN) < 0) {
+                    break;
+                }
+                continue;
+            } else if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        
+        // 把管道中的数据全部送到 dst
+        while (n > 0) {
+            ssize_t m = splice(pipefd[0], NULL, dst, NULL, n, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            server->io_calls++;
+            if (m < 0) {
+                if (errno == EAGAIN) {
+                    if (reactor_wait(dst, EPOLLOUT) < 0) {
+                        goto out;
+                    }
+                    continue;
+                } else if (errno == EINTR) {
+                    continue;
+                }
+                goto out;
+            }
+            n -= m;
+            *bytes += m;
+        }
+    }
+    
+out:
+    close(pipefd[0]);
+    close(pipefd[1]);
+    return rc;
+}
+
+// 对照组：recv 到 arena 中的缓冲区，再 send 出去（每个字节两次复制）
+static int forward_copy(int src, int dst, uint64_t *bytes) {
+    char *buf = (char *)co_alloc(PROXY_CHUNK_SIZE);
+    if (buf == NULL) {
+        perror("co_alloc proxy buffer error");
+        return PROXY_ERROR;
+    }
+    
+    for (;;) {
+        ssize_t n = recv(src, buf, PROXY_CHUNK_SIZE, 0);
+        server->io_calls++;
+        if (n == 0) {
+            return PROXY_EOF;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (reactor_wait(src, EPOLLIN) < 0) {
+                    return PROXY_ERROR;
+                }
+                continue;
+            } else if (errno == EINTR) {
+                continue;
+            }
+            return PROXY_ERROR;
+        }
+        
+        // 不用 net_send_all：每次 send 都要计入系统调用次数，才能和 splice 公平比较
+        ssize_t sent = 0;
+        while (sent < n) {
+            ssize_t w = send(dst, buf + sent, n - sent, MSG_NOSIGNAL);
+            server->io_calls++;
+            if (w < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if (reactor_wait(dst, EPOLLOUT) < 0) {
+                        return PROXY_ERROR;
+                    }
+                    continue;
+                } else if (errno == EINTR) {
+                    continue;
+                }
+                return PROXY_ERROR;
+            }
+            sent += w;
+            *bytes += w;
+        }
+    }
+}
+
+// 方向结束：EOF 时半关闭目标端，让对端看到 EOF，另一个方向继续运行；
+// 出错时关闭两端的读写，唤醒另一个方向让它也结束。最后一个结束的方向关闭套接字
+static void proxy_dir_finish(proxy_conn_t *conn, int dst, int rc) {
+    if (rc == PROXY_EOF) {
+        shutdown(dst, SHUT_WR);
+    } else {
+        shutdown(conn->client_fd, SHUT_RDWR);
+        shutdown(conn->upstream_fd, SHUT_RDWR);
+    }
+    
+    if (--conn->refs == 0) {
+        reactor_remove(conn->client_fd);
+        reactor_remove(conn->upstream_fd);
+        close(conn->client_fd);
+        close(conn->upstream_fd);
+        free(conn);
+    }
+}
+
+// 方向协程的 arena：只有复制模式需要缓冲区，splice 模式不占用 arena
+static size_t proxy_arena_size(void) {
+    return server->opts.copy ? PROXY_ARENA_SIZE : 0;
+}
+
+static int proxy_forward(int src, int dst, uint64_t *bytes) {
+    return server->opts.copy ? forward_copy(src, dst, bytes) : forward_splice(src, dst, bytes);
+}
+
+// 上游 → 客户端方向的协程
+static void proxy_down_handler(void *arg) {
+    const proxy_dir_t *dir = (const proxy_dir_t *)arg;
+    proxy_conn_t *conn = dir->conn;
+    int src = dir->src, dst = dir->dst;
+    uint64_t *bytes = dir->bytes;
+    
+    proxy_dir_finish(conn, dst, proxy_forward(src, dst, bytes));
+}
+
+// 等待非阻塞 connect 完成
+static int proxy_wait_connected(int fd) {
+    for (;;) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
+            return -1;
+        }
+        if (err != 0) {
+            errno = err;
+            return -1;
+        }
+        
+        struct sockaddr_in peer;
+        socklen_t plen = sizeof(peer);
+        if (getpeername(fd, (struct sockaddr *)&peer, &plen) == 0) {
+            return 0;
+        }
+        if (errno != ENOTCONN) {
+            return -1;
+        }
+        // 等待失败时 getpeername 会一直返回 ENOTCONN
+        if (reactor_wait(fd, EPOLLOUT) < 0) {
+            return -1;
+        }
+    }
+}
+
+// 客户端连接的协程：连接上游，启动反方向协程，自己负责客户端 → 上游方向
+static void proxy_conn_handler(void *arg) {
+    int client_fd = *(const int *)arg;
+    
+    int upstream_fd = net_connect_tcp(server->opts.upstream_host, server->opts.upstream_port);
+    if (upstream_fd < 0) {
+        server->upstream_failures++;
+        goto fail;
+    }
+    if (reactor_add(upstream_fd) < 0) {
+        close(upstream_fd);
+        goto fail;
+    }
+    if (proxy_wait_connected(upstream_fd) < 0) {
+        perror("upstream connect error");
+        server->upstream_failures++;
+        reactor_remove(upstream_fd);
+        close(upstream_fd);
+        goto fail;
+    }
+    
+    int on = 1;
+    setsockopt(upstream_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    
+    // 两个方向共享连接结构，谁最后结束谁释放，所以不能放在某个协程的 arena 中
+    proxy_conn_t *conn = (proxy_conn_t *)malloc(sizeof(proxy_conn_t));
+    if (conn == NULL) {
+        reactor_remove(upstream_fd);
+        close(upstream_fd);
+        goto fail;
+    }
+    conn->client_fd = client_fd;
+    conn->upstream_fd = upstream_fd;
+    conn->refs = 1;
+    
+    proxy_dir_t down = { conn, upstream_fd, client_fd, &server->bytes_down };
+    coroutine_t *co = coroutine_create_arena(proxy_down_handler, &down,
+                                             PROXY_STACK_SIZE, proxy_arena_size());
+    if (co == NULL) {
+        perror("coroutine_create error");
+        proxy_dir_finish(conn, upstream_fd, PROXY_ERROR);
+        return;
+    }
+    coroutine_detach(co);
+    conn->refs++;
+    coroutine_resume(co);
+    
+    proxy_dir_finish(conn, upstream_fd, proxy_forward(client_fd, upstream_fd, &server->bytes_up));
+    return;
+    
+fail:
+    reactor_remove(client_fd);
+    close(client_fd);
+}
+
+// 接受连接的协程函数
+static void accept_handler(void *arg) {
+    proxy_server_t *srv = (proxy_server_t *)arg;
+    
+    while (running) {
+        int fd = accept4(srv->listen_fd, NULL, NULL, SOCK_NONBLOCK);
+        if (fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (reactor_wait(srv->listen_fd, EPOLLIN) < 0) {
+                    perror("reactor_wait error");
+                    break;
+                }
+                continue;
+            } else if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            perror("accept error");
+            break;
+        }
+        
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        
+        coroutine_t *co = coroutine_create_arena(proxy_conn_handler, &fd,
+                                                 PROXY_STACK_SIZE, proxy_arena_size());
+        if (co == NULL) {
+            perror("coroutine_create error");
+            close(fd);
+            continue;
+        }
+        coroutine_detach(co);
+        
+        if (reactor_add(fd) < 0) {
+            coroutine_destroy(co);
+            close(fd);
+            continue;
+        }
+        
+        srv->conns_accepted++;
+        
+        // fd 在协程第一次挂起之前保持有效
+        coroutine_resume(co);
+    }
+}
+
+// 信号处理函数
+static void signal_handler(int sig) {
+    if (sig == SIGINT || sig == SIGTERM) {
+        printf("\n收到停止信号，正在关闭代理...\n");
+        running = 0;
+    }
+}
+
+int proxy_server_start(const proxy_options_t *opts) {
+    server = (proxy_server_t *)malloc(sizeof(proxy_server_t));
+    if (server == NULL) {
+        perror("malloc server error");
+        return -1;
+    }
+    memset(server, 0, sizeof(proxy_server_t));
+    server->opts = *opts;
+    server->listen_fd = -1;
+    
+    if (reactor_init() < 0) {
+        free(server);
+        server = NULL;
+        return -1;
+    }
+    
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+    
+    server->listen_fd = net_listen_tcp(opts->port, PROXY_BACKLOG, 0);
+    if (server->listen_fd < 0 || reactor_add(server->listen_fd) < 0) {
+        proxy_server_stop();
+        return -1;
+    }
+    
+    printf("=== TCP Proxy 启动 ===\n");
+    printf("监听端口: %d，上游: %s:%d，模式: %s\n", opts->port,
+           opts->upstream_host, opts->upstream_port, opts->copy ? "recv/send 复制" : "splice");
+    printf("按 Ctrl+C 停止代理\n\n");
+    
+    coroutine_t *co = coroutine_create(accept_handler, server, 64 * 1024);
+    if (co == NULL) {
+        perror("coroutine_create accept_handler error");
+        proxy_server_stop();
+        return -1;
+    }
+    server->accept_co = coroutine_handle(co);
+    coroutine_resume(co);
+    
+    reactor_run(&running);
+    
+    proxy_server_stop();
+    return 0;
+}
+
+// 打印转发字节数、系统调用次数和每 GB 的 CPU 时间（代理是单线程的，进程 CPU 时间即代理开销）
+static void proxy_print_stats(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    double user = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+    double sys = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    uint64_t bytes = server->bytes_up + server->bytes_down;
+    
+    printf("代理统计（%s）: 接受 %llu 个连接，上游连接失败 %llu 个\n",
+           server->opts.copy ? "recv/send 复制" : "splice",
+           (unsigned long long)server->conns_accepted,
+           (unsigned long long)server->upstream_failures);
+    printf("  转发 %.3f GB（上行 %.3f，下行 %.3f），系统调用 %llu 次",
+           bytes / 1e9, server->bytes_up / 1e9, server->bytes_down / 1e9,
+           (unsigned long long)server->io_calls);
+    if (server->io_calls > 0) {
+        printf("，平均每次 %.0f 字节", (double)bytes / server->io_calls);
+    }
+    printf("\n");
+    printf("  CPU 时间: 用户态 %.2f 秒，内核态 %.2f 秒", user, sys);
+    if (bytes > 0) {
+        printf("，每 GB %.3f 秒", (user + sys) / (bytes / 1e9));
+    }
+    printf("\n");
+}
+
+void proxy_server_stop(void) {
+    if (server == NULL) {
+        return;
+    }
+    
+    coroutine_destroy(coroutine_lookup(server->accept_co));
+    
+    if (server->listen_fd >= 0) {
+        proxy_print_stats();
+        reactor_remove(server->listen_fd);
+        close(server->listen_fd);
+    }
+    
+    reactor_destroy();
+    coroutine_thread_exit();
+    
+    free(server);
+    server = NULL;
+    
+    printf("代理已关闭\n");
+}
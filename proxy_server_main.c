@@ -0,0 +1,66 @@
+#define _GNU_SOURCE
+#include "proxy_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void usage(const char *prog) {
+    fprintf(stderr, "使用方法: %s [-u 主机:端口] [-c] [端口号]\n", prog);
+    fprintf(stderr, "  -u  上游地址（默认 %s:%d）\n",
+            PROXY_DEFAULT_UPSTREAM_HOST, PROXY_DEFAULT_UPSTREAM_PORT);
+    fprintf(stderr, "  -c  用 recv/send 复制数据（对照组，默认 splice）\n");
+}
+
+int main(int argc, char *argv[]) {
+    proxy_options_t opts = { PROXY_DEFAULT_PORT, PROXY_DEFAULT_UPSTREAM_HOST,
+                             PROXY_DEFAULT_UPSTREAM_PORT, 0 };
+    int opt;
+    
+    while ((opt = getopt(argc, argv, "u:c")) != -1) {
+        switch (opt) {
+        case 'u': {
+            // 主机:端口，只给端口时使用默认主机
+            char *colon = strrchr(optarg, ':');
+            if (colon != NULL) {
+                *colon = '\0';
+                opts.upstream_host = optarg;
+                opts.upstream_port = atoi(colon + 1);
+            } else {
+                opts.upstream_port = atoi(optarg);
+            }
+            break;
+        }
+        case 'c':
+            opts.copy = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (opts.upstream_port <= 0 || opts.upstream_port > 65535) {
+        fprintf(stderr, "无效的上游端口\n");
+        usage(argv[0]);
+        return 1;
+    }
+    
+    if (optind < argc) {
+        opts.port = atoi(argv[optind]);
+        if (opts.port <= 0 || opts.port > 65535) {
+            fprintf(stderr, "无效的端口号: %s\n", argv[optind]);
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    printf("启动 TCP Proxy，端口: %d\n", opts.port);
+    
+    if (proxy_server_start(&opts) < 0) {
+        fprintf(stderr, "启动代理失败\n");
+        return 1;
+    }
+    
+    return 0;
+}
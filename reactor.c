@@ -0,0 +1,278 @@
+#define _GNU_SOURCE
+#include "reactor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+// 每个 fd 的等待者（读、写各一个）和可选的超时
+// 带超时的 fd 按截止时间串成双向链表（以 fd 为链接），超时时长相同时插入是 O(1)
+typedef struct reactor_waiters {
+    coroutine_handle_t reader;
+    coroutine_handle_t writer;
+    int64_t deadline;            // 截止时间（毫秒，单调时钟），-1 表示没有超时
+    int timer_prev;              // 超时链表中的前后 fd，-1 表示链表端点
+    int timer_next;
+    int timed_out;               // 等待因超时结束
+    int registered;              // 已通过 reactor_add 注册到 epoll
+} reactor_waiters_t;
+
+// 每个线程一个 reactor
+static _Thread_local int epoll_fd = -1;
+static _Thread_local reactor_waiters_t *waiters = NULL;  // 以 fd 为下标
+static _Thread_local int waiters_cap = 0;
+static _Thread_local struct epoll_event events[REACTOR_MAX_EVENTS];
+static _Thread_local int timer_head = -1;                 // 最早到期的 fd
+static _Thread_local int timer_tail = -1;                 // 最晚到期的 fd
+
+// 粗粒度单调时钟（毫秒），超时精度不需要高于时钟节拍
+int64_t reactor_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 按截止时间插入超时链表：从尾部向前找插入点
+static void timer_link(int fd) {
+    reactor_waiters_t *w = &waiters[fd];
+    int after = timer_tail;
+    while (after >= 0 && waiters[after].deadline > w->deadline) {
+        after = waiters[after].timer_prev;
+    }
+    
+    w->timer_prev = after;
+    w->timer_next = after >= 0 ? waiters[after].timer_next : timer_head;
+    if (w->timer_next >= 0) {
+        waiters[w->timer_next].timer_prev = fd;
+    } else {
+        timer_tail = fd;
+    }
+    if (after >= 0) {
+        waiters[after].timer_next = fd;
+    } else {
+        timer_head = fd;
+    }
+}
+
+static void timer_unlink(int fd) {
+    reactor_waiters_t *w = &waiters[fd];
+    if (w->deadline < 0) {
+        return;
+    }
+    if (w->timer_prev >= 0) {
+        waiters[w->timer_prev].timer_next = w->timer_next;
+    } else {
+        timer_head = w->timer_next;
+    }
+    if (w->timer_next >= 0) {
+        waiters[w->timer_next].timer_prev = w->timer_prev;
+    } else {
+        timer_tail = w->timer_prev;
+    }
+    w->deadline = -1;
+    w->timer_prev = w->timer_next = -1;
+}
+
+// 唤醒所有已到期的等待者
+static void timer_expire(void) {
+    int64_t now = reactor_now_ms();
+    while (timer_head >= 0 && waiters[timer_head].deadline <= now) {
+        int fd = timer_head;
+        reactor_waiters_t *w = &waiters[fd];
+        timer_unlink(fd);
+        w->timed_out = 1;
+        if (w->reader != COROUTINE_HANDLE_INVALID) {
+            coroutine_schedule(w->reader);
+            w->reader = COROUTINE_HANDLE_INVALID;
+        }
+        if (w->writer != COROUTINE_HANDLE_INVALID) {
+            coroutine_schedule(w->writer);
+            w->writer = COROUTINE_HANDLE_INVALID;
+        }
+    }
+}
+
+static int waiters_reserve(int fd) {
+    if (fd < waiters_cap) {
+        return 0;
+    }
+    
+    int new_cap = waiters_cap ? waiters_cap : 64;
+    while (new_cap <= fd) {
+        new_cap *= 2;
+    }
+    
+    reactor_waiters_t *w = (reactor_waiters_t *)realloc(waiters, new_cap * sizeof(*w));
+    if (w == NULL) {
+        return -1;
+    }
+    memset(w + waiters_cap, 0, (new_cap - waiters_cap) * sizeof(*w));
+    for (int i = waiters_cap; i < new_cap; i++) {
+        w[i].deadline = -1;
+        w[i].timer_prev = w[i].timer_next = -1;
+    }
+    waiters = w;
+    waiters_cap = new_cap;
+    return 0;
+}
+
+int reactor_init(void) {
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) {
+        perror("epoll_create1 error");
+        return -1;
+    }
+    return 0;
+}
+
+void reactor_destroy(void) {
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    free(waiters);
+    waiters = NULL;
+    waiters_cap = 0;
+    timer_head = timer_tail = -1;
+}
+
+int reactor_add(int fd) {
+    if (waiters_reserve(fd) < 0) {
+        return -1;
+    }
+    waiters[fd].reader = COROUTINE_HANDLE_INVALID;
+    waiters[fd].writer = COROUTINE_HANDLE_INVALID;
+    waiters[fd].timed_out = 0;
+    
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;  // 边缘触发模式
+    ev.data.fd = fd;
+    
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        perror("epoll_ctl ADD error");
+        return -1;
+    }
+    waiters[fd].registered = 1;
+    return 0;
+}
+
+void reactor_remove(int fd) {
+    if (fd < 0 || fd >= waiters_cap) {
+        return;
+    }
+    waiters[fd].reader = COROUTINE_HANDLE_INVALID;
+    waiters[fd].writer = COROUTINE_HANDLE_INVALID;
+    timer_unlink(fd);
+    waiters[fd].registered = 0;
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+// 等待槽位被其他存活协程占用（句柄已失效的残留登记可以直接覆盖）
+static int waiter_busy(coroutine_handle_t slot, coroutine_handle_t self) {
+    return slot != COROUTINE_HANDLE_INVALID && slot != self && coroutine_lookup(slot) != NULL;
+}
+
+int reactor_wait(int fd, uint32_t events) {
+    return reactor_wait_timeout(fd, events, -1);
+}
+
+int reactor_wait_timeout(int fd, uint32_t events, int timeout_ms) {
+    coroutine_t *co = coroutine_current();
+    // 未注册的 fd 永远不会有事件，挂起后再也不会被唤醒
+    if (co == NULL || fd < 0 || fd >= waiters_cap || !waiters[fd].registered) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    // 同一方向已有另一个存活的协程在等待：覆盖会让它永远不被唤醒
+    coroutine_handle_t h = coroutine_handle(co);
+    if (((events & EPOLLIN) && waiter_busy(waiters[fd].reader, h)) ||
+        ((events & EPOLLOUT) && waiter_busy(waiters[fd].writer, h))) {
+        errno = EBUSY;
+        return -1;
+    }
+    if (events & EPOLLIN) {
+        waiters[fd].reader = h;
+    }
+    if (events & EPOLLOUT) {
+        waiters[fd].writer = h;
+    }
+    if (timeout_ms >= 0) {
+        timer_unlink(fd);
+        waiters[fd].deadline = reactor_now_ms() + timeout_ms;
+        waiters[fd].timed_out = 0;
+        timer_link(fd);
+    }
+    
+    coroutine_yield(co);
+    
+    // 被其他途径唤醒时清除残留的登记，避免之后被误唤醒
+    int timed_out = 0;
+    if (fd < waiters_cap) {
+        if (waiters[fd].reader == h) {
+            waiters[fd].reader = COROUTINE_HANDLE_INVALID;
+        }
+        if (waiters[fd].writer == h) {
+            waiters[fd].writer = COROUTINE_HANDLE_INVALID;
+        }
+        if (timeout_ms >= 0) {
+            timer_unlink(fd);
+            timed_out = waiters[fd].timed_out;
+            waiters[fd].timed_out = 0;
+        }
+    }
+    return timed_out;
+}
+
+// 唤醒 fd 上满足事件的等待者（句柄失效时 coroutine_schedule 直接忽略）
+static void reactor_dispatch(int fd, uint32_t ev) {
+    if (fd < 0 || fd >= waiters_cap) {
+        return;
+    }
+    
+    reactor_waiters_t *w = &waiters[fd];
+    if ((ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) &&
+        w->reader != COROUTINE_HANDLE_INVALID) {
+        coroutine_schedule(w->reader);
+        w->reader = COROUTINE_HANDLE_INVALID;
+    }
+    if ((ev & (EPOLLOUT | EPOLLHUP | EPOLLERR)) &&
+        w->writer != COROUTINE_HANDLE_INVALID) {
+        coroutine_schedule(w->writer);
+        w->writer = COROUTINE_HANDLE_INVALID;
+    }
+    // 等待者都已唤醒，不再让超时覆盖这次事件
+    if (w->reader == COROUTINE_HANDLE_INVALID && w->writer == COROUTINE_HANDLE_INVALID) {
+        timer_unlink(fd);
+    }
+}
+
+void reactor_run(volatile int *running) {
+    while (*running) {
+        // 还有就绪协程时不阻塞；有超时等待时最多睡到最早的截止时间
+        int timeout = coroutine_ready_count() > 0 ? 0 : REACTOR_POLL_TIMEOUT_MS;
+        if (timeout > 0 && timer_head >= 0) {
+            int64_t left = waiters[timer_head].deadline - reactor_now_ms();
+            timeout = left <= 0 ? 0 : (left < timeout ? (int)left : timeout);
+        }
+        int nfds = epoll_wait(epoll_fd, events, REACTOR_MAX_EVENTS, timeout);
+        
+        if (nfds < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait error");
+            break;
+        }
+        
+        for (int i = 0; i < nfds; i++) {
+            reactor_dispatch(events[i].data.fd, events[i].events);
+        }
+        timer_expire();
+        
+        // 让所有就绪的协程运行
+        coroutine_run_ready();
+    }
+}
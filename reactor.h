@@ -0,0 +1,74 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include "coroutine.h"
+#include <stdint.h>
+#include <sys/epoll.h>
+
+// 每次 epoll_wait 最多取回的事件数
+#define REACTOR_MAX_EVENTS 1024
+
+// 没有就绪协程时 epoll_wait 的超时（毫秒），用于定期检查停止标志
+#define REACTOR_POLL_TIMEOUT_MS 100
+
+// reactor 的状态是线程私有的：每个工作线程调用一次 reactor_init，
+// 只能等待本线程创建的协程
+
+/**
+ * 创建 epoll 实例
+ * @return 0 成功，-1 失败
+ */
+int reactor_init(void);
+
+/**
+ * 销毁 epoll 实例和等待表
+ */
+void reactor_destroy(void);
+
+/**
+ * 以边缘触发方式注册 fd（同时关注可读和可写）
+ * @param fd 非阻塞文件描述符
+ * @return 0 成功，-1 失败
+ */
+int reactor_add(int fd);
+
+/**
+ * 注销 fd，清除等待它的协程（必须在 close 之前调用）
+ * @param fd 文件描述符
+ */
+void reactor_remove(int fd);
+
+/**
+ * 挂起当前协程，直到 fd 满足 events（EPOLLIN / EPOLLOUT）
+ * 调用前必须已经读/写到 EAGAIN；返回后应重试 I/O（允许虚假唤醒）
+ * 每个 fd 最多一个读等待者和一个写等待者
+ * @param fd 已注册的文件描述符
+ * @param events EPOLLIN 和/或 EPOLLOUT
+ * @return 0 被唤醒；-1 失败：不在协程中或 fd 未注册（errno 为 EINVAL），
+ *         或该方向已有其他协程在等待（errno 为 EBUSY）
+ */
+int reactor_wait(int fd, uint32_t events);
+
+/**
+ * 同 reactor_wait，但最多等待 timeout_ms 毫秒
+ * 每个 fd 同一时刻最多一个带超时的等待；超时精度为粗粒度时钟节拍（数毫秒）
+ * @param fd 已注册的文件描述符
+ * @param events EPOLLIN 和/或 EPOLLOUT
+ * @param timeout_ms 超时（毫秒），负数表示不超时
+ * @return 0 被唤醒，1 超时，-1 失败（errno 同 reactor_wait）
+ */
+int reactor_wait_timeout(int fd, uint32_t events, int timeout_ms);
+
+/**
+ * 超时使用的粗粒度单调时钟，用于计算跨多次等待的截止时间
+ * @return 当前时间（毫秒）
+ */
+int64_t reactor_now_ms(void);
+
+/**
+ * 事件循环：等待事件，把等待者放入就绪队列并运行，直到 *running 为0
+ * @param running 停止标志
+ */
+void reactor_run(volatile int *running);
+
+#endif // REACTOR_H
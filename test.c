@@ -1,6 +1,11 @@
+#define _GNU_SOURCE
 #include "coroutine.h"
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
 
 // 测试协程1
 static void coroutine_func1(void *arg) {
@@ -30,6 +35,45 @@ static void coroutine_func2(void *arg) {
     printf("协程 %d: 执行完毕\n", id);
 }
 
+// arena 测试协程：小分配来自 arena，超大分配回退到堆，复位后地址重新可用
+static void arena_func(void *arg) {
+    int *ok = (int *)arg;
+    
+    co_arena_mark_t mark = co_arena_mark();
+    char *a = (char *)co_alloc(100);
+    char *b = (char *)co_alloc(100);
+    char *big = (char *)co_alloc(64 * 1024);
+    
+    *ok = a != NULL && b != NULL && big != NULL &&
+          ((uintptr_t)a % COROUTINE_ARENA_ALIGN) == 0 &&
+          b == a + 112;
+    memset(big, 0, 64 * 1024);
+    
+    co_arena_reset(mark);
+    *ok = *ok && co_alloc(100) == a;
+}
+
+// 协程局部存储测试：内联键和溢出键，值在协程之间互不影响
+static co_local_key_t local_keys[COROUTINE_LOCAL_INLINE + 2];
+static int local_dtor_calls = 0;
+
+static void local_dtor(void *value) {
+    (void)value;
+    local_dtor_calls++;
+}
+
+static void local_func(void *arg) {
+    int *ok = (int *)arg;
+    co_local_key_t inline_key = local_keys[0];
+    co_local_key_t overflow_key = local_keys[COROUTINE_LOCAL_INLINE + 1];
+    
+    *ok = co_local_get(inline_key) == NULL && co_local_get(overflow_key) == NULL &&
+          co_local_set(inline_key, ok) == 0 && co_local_set(overflow_key, ok + 1) == 0;
+    coroutine_yield(coroutine_current());
+    *ok = *ok && co_local_get(inline_key) == ok && co_local_get(overflow_key) == ok + 1;
+    coroutine_yield(coroutine_current());
+}
+
 int main(void) {
     printf("=== 协程测试程序 ===\n\n");
     
@@ -65,9 +109,138 @@ int main(void) {
     printf("\n所有协程执行完毕\n");
     
     // 清理资源
+    coroutine_handle_t h1 = coroutine_handle(co1);
     coroutine_destroy(co1);
     coroutine_destroy(co2);
     
+    // 句柄测试：销毁后旧句柄失效，槽位复用后也不会指向新协程
+    printf("\n=== 句柄测试 ===\n");
+    coroutine_t *co3 = coroutine_create(coroutine_func2, &arg2, 64 * 1024);
+    if (co3 == NULL) {
+        fprintf(stderr, "创建协程失败\n");
+        return 1;
+    }
+    coroutine_handle_t h3 = coroutine_handle(co3);
+    
+    if (coroutine_lookup(h1) != NULL || coroutine_resume_handle(h1) != -1) {
+        fprintf(stderr, "失效句柄仍然可用\n");
+        return 1;
+    }
+    if (h3 == h1 || coroutine_lookup(h3) != co3) {
+        fprintf(stderr, "新句柄查找失败\n");
+        return 1;
+    }
+    printf("失效句柄被拒绝，新句柄正常\n");
+    
+    // 就绪队列 + 分离：协程执行完毕后自动销毁，句柄随之失效
+    coroutine_detach(co3);
+    while (coroutine_lookup(h3) != NULL) {
+        coroutine_schedule(h3);
+        coroutine_run_ready();
+    }
+    printf("分离的协程执行完毕后已自动回收\n");
+    
+    // arena 测试
+    printf("\n=== arena 测试 ===\n");
+    int arena_ok = 0;
+    coroutine_t *co4 = coroutine_create_arena(arena_func, &arena_ok, 64 * 1024, 4096);
+    if (co4 == NULL) {
+        fprintf(stderr, "创建协程失败\n");
+        return 1;
+    }
+    coroutine_resume(co4);
+    coroutine_destroy(co4);
+    if (!arena_ok || co_alloc(16) != NULL) {
+        fprintf(stderr, "arena 分配结果不正确\n");
+        return 1;
+    }
+    printf("arena 分配、堆回退和复位正常\n");
+    
+    // 协程局部存储测试：两个协程交替运行；一个执行完毕，一个挂起时被回收，析构函数各运行两次
+    printf("\n=== 协程局部存储测试 ===\n");
+    for (int i = 0; i < COROUTINE_LOCAL_INLINE + 2; i++) {
+        if (co_local_key_create(&local_keys[i], local_dtor) < 0 ||
+            local_keys[i] != (co_local_key_t)i) {
+            fprintf(stderr, "注册局部存储键失败\n");
+            return 1;
+        }
+    }
+    int local_ok[2][2] = {{0, 0}, {0, 0}};
+    coroutine_t *co5 = coroutine_create(local_func, local_ok[0], 64 * 1024);
+    coroutine_t *co6 = coroutine_create(local_func, local_ok[1], 64 * 1024);
+    if (co5 == NULL || co6 == NULL) {
+        fprintf(stderr, "创建协程失败\n");
+        return 1;
+    }
+    coroutine_resume(co5);
+    coroutine_resume(co6);
+    coroutine_resume(co5);
+    coroutine_resume(co6);
+    coroutine_resume(co5);
+    if (co5->state != COROUTINE_FINISHED || local_dtor_calls != 2) {
+        fprintf(stderr, "协程结束时局部存储析构函数未运行\n");
+        return 1;
+    }
+    coroutine_destroy(co5);
+    coroutine_destroy(co6);
+    if (!local_ok[0][0] || !local_ok[1][0] || local_dtor_calls != 4 ||
+        co_local_get(local_keys[0]) != NULL || co_local_set(local_keys[0], NULL) != -1) {
+        fprintf(stderr, "协程局部存储结果不正确\n");
+        return 1;
+    }
+    printf("局部存储按协程隔离，溢出槽位和析构函数正常\n");
+    
+    // 线程退出清理：挂起的协程被销毁（析构函数运行），句柄失效，之后仍可重新创建协程
+    printf("\n=== 线程退出清理测试 ===\n");
+    int exit_ok[2] = {0, 0};
+    coroutine_t *co7 = coroutine_create(local_func, exit_ok, 64 * 1024);
+    if (co7 == NULL) {
+        fprintf(stderr, "创建协程失败\n");
+        return 1;
+    }
+    coroutine_handle_t h7 = coroutine_handle(co7);
+    coroutine_resume(co7);
+    coroutine_thread_exit();
+    if (local_dtor_calls != 6 || coroutine_lookup(h7) != NULL) {
+        fprintf(stderr, "线程退出时未销毁挂起的协程\n");
+        return 1;
+    }
+    coroutine_t *co8 = coroutine_create_arena(arena_func, &arena_ok, 64 * 1024, 4096);
+    if (co8 == NULL) {
+        fprintf(stderr, "清理后创建协程失败\n");
+        return 1;
+    }
+    arena_ok = 0;
+    coroutine_resume(co8);
+    coroutine_destroy(co8);
+    coroutine_thread_exit();
+    if (!arena_ok) {
+        fprintf(stderr, "清理后协程运行不正确\n");
+        return 1;
+    }
+    printf("slab、内存块池和就绪队列已释放，之后可以重新创建协程\n");
+    
+    printf("\n=== arena 保护页测试 ===\n");
+    // 在子进程中写入 arena 之后的一页（从池中复用的块也要保留保护），应当被 SIGSEGV 终止
+    pid_t pid = fork();
+    if (pid == 0) {
+        coroutine_t *g = coroutine_create_arena(arena_func, &arena_ok, 64 * 1024, 100);
+        coroutine_destroy(g);
+        g = coroutine_create_arena(arena_func, &arena_ok, 64 * 1024, 100);
+        if (g == NULL) {
+            _exit(2);
+        }
+        *(volatile char *)g->arena_end = 1;
+        _exit(0);
+    }
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid ||
+        !WIFSIGNALED(status) || WTERMSIG(status) != SIGSEGV) {
+        fprintf(stderr, "写入保护页没有触发 SIGSEGV\n");
+        return 1;
+    }
+    printf("写入 arena 与栈之间的保护页触发 SIGSEGV\n");
+    
     printf("\n=== 测试完成 ===\n");
     return 0;
 }
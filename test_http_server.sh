@@ -0,0 +1,60 @@
+#!/bin/bash
+
+# HTTP Server 测试脚本
+# 检查请求体分两次到达、随后空闲一段时间的 keep-alive 连接不会被上一个请求的计时关闭
+
+set -e
+
+PORT=18088
+IDLE_MS=1000
+SERVER_PID=0
+
+# 清理函数
+cleanup() {
+    if [ $SERVER_PID -ne 0 ]; then
+        echo "停止服务器 (PID: $SERVER_PID)"
+        kill $SERVER_PID 2>/dev/null || true
+        wait $SERVER_PID 2>/dev/null || true
+    fi
+}
+
+# 注册清理函数；服务器提前关闭连接时写入返回错误，而不是让 SIGPIPE 终止脚本
+trap cleanup EXIT
+trap '' PIPE
+
+echo "=== 编译项目 ==="
+make http_server
+
+echo ""
+echo "=== 启动 HTTP Server（空闲超时 $IDLE_MS ms）==="
+./http_server -t 1 -i $IDLE_MS $PORT > /tmp/test_http_server.log 2>&1 &
+SERVER_PID=$!
+sleep 1
+
+if ! kill -0 $SERVER_PID 2>/dev/null; then
+    echo "错误: 服务器启动失败"
+    cat /tmp/test_http_server.log
+    exit 1
+fi
+
+# 请求体在 0.8 秒时才收完，再过 0.5 秒发送下一个请求：
+# 第二个请求距离第一个请求开始已超过空闲超时，但距离上一个请求读完只有 0.5 秒
+echo ""
+echo "=== 请求体分段到达后空闲 ==="
+exec 3<>/dev/tcp/127.0.0.1/$PORT
+printf 'POST / HTTP/1.1\r\nHost: x\r\nContent-Length: 10\r\n\r\n01234' >&3
+sleep 0.8
+printf '56789' >&3 2>/dev/null || true
+sleep 0.5
+printf 'GET / HTTP/1.1\r\nHost: x\r\n\r\n' >&3 2>/dev/null || true
+# 读到服务器因空闲超时关闭连接为止
+RESPONSES=$(timeout 5 cat <&3 | grep -o 'HTTP/1\.1 [0-9]' | wc -l)
+exec 3<&-
+echo "收到 $RESPONSES 个响应"
+if [ "$RESPONSES" -ne 2 ]; then
+    echo "错误: 应收到 2 个响应"
+    exit 1
+fi
+
+echo ""
+echo "=== 测试完成 ==="